@@ -0,0 +1,95 @@
+#ifndef BITFLIPCLASSIFIER_H_
+#define BITFLIPCLASSIFIER_H_
+
+#include "memorycontext.h"
+#include "scanpattern.h"
+#include "logging.h"
+
+/* Size of the event log in the HyperRAM */
+#define FLIP_LOG_ENTRIES 65536
+
+#define FLIP_SECTOR_SIZE 4096
+#define FLIP_SECTOR_COUNT 2048 /* 8MB Flash */
+
+/* Two flips within this many bytes in the same pass are counted as a cluster */
+#define FLIP_CLUSTER_DISTANCE 16
+
+enum FlipType
+{
+	FLIP_SEU,
+	FLIP_STICKY,
+	FLIP_CLUSTER,
+	FLIP_TYPE_COUNT,
+};
+
+/**
+ * @brief History of one 4K Sector, lives in the HyperRAM (16 Bytes)
+ */
+struct SectorHistory
+{
+	uint16_t count[FLIP_TYPE_COUNT];
+	uint16_t next;			/* Next slot in recent that gets overwritten */
+	uint16_t recent[4];		/* (offset in sector << 3) | bit of the latest flipped bits, 0xFFFF if empty */
+};
+
+/**
+ * @brief Classified event as it is logged to the HyperRAM (8 Bytes)
+ */
+struct ClassifiedFlip
+{
+	uint32_t address;
+	uint16_t pass;
+	uint8_t flipped;
+	uint8_t type;
+};
+
+/**
+ * @brief Classifies every mismatch of a scan as single event upset, sticky bit (seen again
+ * in a later pass) or cluster (several flips close to each other), in O(1) per event
+ */
+class BitFlipClassifier : public ScanMismatchSink
+{
+public:
+	BitFlipClassifier(MemoryContext& memory);
+
+	/**
+	 * @brief Clears the sector history and the event log
+	 */
+	void reset();
+
+	void onMismatch(const ScanMismatch& mismatch);
+
+	uint32_t getCount(FlipType type) { return counts[type]; }
+	uint32_t getLoggedEvents() { return log_index; }
+	uint32_t getDroppedEvents() { return dropped; }
+
+private:
+	/**
+	 * @brief Remembers the flipped bits of the byte in the sector history
+	 */
+	void remember(volatile SectorHistory& sector_history, uint16_t offset, uint8_t flipped);
+
+	void append(const ClassifiedFlip& flip);
+
+	volatile SectorHistory* history;
+	volatile ClassifiedFlip* flip_log;
+
+	/* Entries of the log region, 0 if the HyperRAM had no room for the classifier */
+	uint32_t log_entries = 0;
+
+	uint32_t counts[FLIP_TYPE_COUNT] = {0};
+	uint32_t log_index = 0;
+	uint32_t dropped = 0;
+
+	/* Last event, needed to detect clusters */
+	bool has_last = false;
+	uint32_t last_address = 0;
+	uint32_t last_pass = 0;
+	uint32_t last_log_index = 0;
+	uint8_t last_type = FLIP_SEU;
+
+	static constexpr uint16_t EMPTY = 0xFFFF;
+	static constexpr uint16_t RECENT_MASK = 0x03;
+};
+
+#endif // BITFLIPCLASSIFIER_H_
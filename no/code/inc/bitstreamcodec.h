@@ -0,0 +1,385 @@
+#ifndef BITSTREAMCODEC_H_
+#define BITSTREAMCODEC_H_
+
+#include "stdint.h"
+
+/*
+ * Run length / LZ format for ICE40 Bitstreams, shared by the firmware (decoder)
+ * and the host tools (encoder), so it must not depend on anything but stdint.
+ *
+ * Header (8 Bytes):	'L' 'Z' 'R' '1', raw length (uint32 little endian)
+ * Tokens, selected by the control byte c:
+ *	0x00 - 0x7F		literal, (c + 1) Bytes follow
+ *	0x80 - 0xBF		run, length ((c & 0x3F) << 8 | next Byte) + 3, followed by the repeated Byte
+ *	0xC0 - 0xFF		back reference, length (c & 0x3F) + 3, followed by (distance - 1),
+ *					copies from the last CODEC_WINDOW_SIZE decoded Bytes
+ */
+
+#define CODEC_MAGIC 0x31525A4C /* "LZR1" little endian */
+#define CODEC_HEADER_SIZE 8
+#define CODEC_WINDOW_SIZE 256
+
+#define CODEC_LITERAL_MAX 128
+#define CODEC_RUN_MIN 4
+#define CODEC_RUN_MAX ((0x3F << 8 | 0xFF) + 3)
+#define CODEC_MATCH_MIN 3
+#define CODEC_MATCH_MAX (0x3F + 3)
+
+class BitstreamCodec
+{
+public:
+	/**
+	 * @brief Checks for the magic and returns the raw length of a compressed image
+	 *
+	 * @retval false if header is no compressed image
+	 */
+	static bool parseHeader(const uint8_t* header, uint32_t& raw_length)
+	{
+		uint32_t magic = header[0] | header[1] << 8 | header[2] << 16 | (uint32_t)header[3] << 24;
+		raw_length = header[4] | header[5] << 8 | header[6] << 16 | (uint32_t)header[7] << 24;
+
+		return magic == CODEC_MAGIC;
+	}
+
+	/**
+	 * @brief Upper bound for the size of an encoded image, every 128 Bytes cost one control Byte at worst
+	 */
+	static uint32_t maxEncodedSize(uint32_t len)
+	{
+		return CODEC_HEADER_SIZE + len + (len + CODEC_LITERAL_MAX - 1) / CODEC_LITERAL_MAX;
+	}
+
+	/**
+	 * @brief Compresses src greedily, runs first, then the longest back reference
+	 *
+	 * @param dst has to hold maxEncodedSize(len) Bytes
+	 * @retval size of the encoded image including the header
+	 */
+	static uint32_t encode(const uint8_t* src, uint32_t len, uint8_t* dst)
+	{
+		uint32_t out = 0;
+		dst[out++] = CODEC_MAGIC & 0xFF;
+		dst[out++] = (CODEC_MAGIC >> 8) & 0xFF;
+		dst[out++] = (CODEC_MAGIC >> 16) & 0xFF;
+		dst[out++] = (CODEC_MAGIC >> 24) & 0xFF;
+		dst[out++] = len & 0xFF;
+		dst[out++] = (len >> 8) & 0xFF;
+		dst[out++] = (len >> 16) & 0xFF;
+		dst[out++] = (len >> 24) & 0xFF;
+
+		uint32_t literal_start = 0;
+		uint32_t literal_len = 0;
+		uint32_t i = 0;
+
+		while(i < len)
+		{
+			uint32_t run = 1;
+			while(i + run < len && run < CODEC_RUN_MAX && src[i + run] == src[i])
+			{
+				run++;
+			}
+
+			uint32_t match = 0;
+			uint32_t distance = 0;
+			if(run < CODEC_RUN_MIN)
+			{
+				for(uint32_t d = 1; d <= CODEC_WINDOW_SIZE && d <= i; d++)
+				{
+					uint32_t l = 0;
+					while(i + l < len && l < CODEC_MATCH_MAX && src[i + l] == src[i - d + l])
+					{
+						l++;
+					}
+
+					if(l > match)
+					{
+						match = l;
+						distance = d;
+					}
+				}
+			}
+
+			if(run >= CODEC_RUN_MIN || match >= CODEC_MATCH_MIN)
+			{
+				out = flushLiterals(src + literal_start, literal_len, dst, out);
+				literal_len = 0;
+
+				if(run >= CODEC_RUN_MIN)
+				{
+					uint32_t code = run - 3;
+					dst[out++] = 0x80 | (code >> 8);
+					dst[out++] = code & 0xFF;
+					dst[out++] = src[i];
+					i += run;
+				}
+				else
+				{
+					dst[out++] = 0xC0 | (match - 3);
+					dst[out++] = distance - 1;
+					i += match;
+				}
+				continue;
+			}
+
+			if(literal_len == 0)
+			{
+				literal_start = i;
+			}
+			literal_len++;
+			i++;
+
+			if(literal_len == CODEC_LITERAL_MAX)
+			{
+				out = flushLiterals(src + literal_start, literal_len, dst, out);
+				literal_len = 0;
+			}
+		}
+
+		return flushLiterals(src + literal_start, literal_len, dst, out);
+	}
+
+private:
+	static uint32_t flushLiterals(const uint8_t* literals, uint32_t len, uint8_t* dst, uint32_t out)
+	{
+		if(len == 0)
+		{
+			return out;
+		}
+
+		dst[out++] = len - 1;
+		for(uint32_t i = 0; i < len; i++)
+		{
+			dst[out++] = literals[i];
+		}
+
+		return out;
+	}
+};
+
+enum BitstreamStreamResult
+{
+	STREAM_OK,
+	STREAM_BAD_HEADER,
+	STREAM_TRUNCATED,
+};
+
+/**
+ * @brief Streaming decoder, the compressed data can be fed in arbitrary chunks
+ * and the output is produced into a buffer of any size
+ */
+class BitstreamDecoder
+{
+public:
+	/**
+	 * @brief Starts decoding a new image, raw_length from BitstreamCodec::parseHeader()
+	 */
+	void reset(uint32_t raw_length)
+	{
+		remaining_output = raw_length;
+		state = CONTROL;
+		window_pos = 0;
+	}
+
+	/**
+	 * @brief Decodes till either src is used up, dst is full or the image is complete
+	 *
+	 * @param consumed amount of Bytes taken from src
+	 * @retval amount of Bytes written to dst
+	 */
+	uint32_t decode(const uint8_t* src, uint32_t src_len, uint32_t& consumed, uint8_t* dst, uint32_t dst_len)
+	{
+		uint32_t in = 0;
+		uint32_t out = 0;
+
+		while(out < dst_len && remaining_output)
+		{
+			if(state == RUN || state == COPY)
+			{
+				uint8_t byte = (state == RUN) ? value : window[(window_pos - distance) & WINDOW_MASK];
+				window[window_pos++ & WINDOW_MASK] = byte;
+				dst[out++] = byte;
+				remaining_output--;
+
+				if(--remaining_token == 0)
+				{
+					state = CONTROL;
+				}
+				continue;
+			}
+
+			if(in >= src_len)
+			{
+				break;
+			}
+
+			uint8_t byte = src[in++];
+			switch(state)
+			{
+				case CONTROL:
+				{
+					if(byte < 0x80)
+					{
+						remaining_token = byte + 1;
+						state = LITERAL;
+					}
+					else if(byte < 0xC0)
+					{
+						remaining_token = (byte & 0x3F) << 8;
+						state = RUN_LENGTH;
+					}
+					else
+					{
+						remaining_token = (byte & 0x3F) + 3;
+						state = DISTANCE;
+					}
+					break;
+				}
+				case LITERAL:
+				{
+					window[window_pos++ & WINDOW_MASK] = byte;
+					dst[out++] = byte;
+					remaining_output--;
+
+					if(--remaining_token == 0)
+					{
+						state = CONTROL;
+					}
+					break;
+				}
+				case RUN_LENGTH:
+				{
+					remaining_token = (remaining_token | byte) + 3;
+					state = RUN_VALUE;
+					break;
+				}
+				case RUN_VALUE:
+				{
+					value = byte;
+					state = RUN;
+					break;
+				}
+				case DISTANCE:
+				{
+					distance = byte + 1;
+					state = COPY;
+					break;
+				}
+				default:
+				{
+					break;
+				}
+			}
+		}
+
+		consumed = in;
+		return out;
+	}
+
+	/**
+	 * @brief Decodes a whole image in CHUNK_SIZE chunks, the way the firmware streams it into the ICE40,
+	 * while a decoded chunk is written the next compressed one is read if the decoder needs it
+	 *
+	 * Port provides
+	 *	void read(uint32_t offset, uint8_t* dst, uint32_t len)
+	 *	void readWhileWriting(uint32_t offset, uint8_t* dst, uint32_t len, const uint8_t* src, uint32_t src_len)
+	 * the image is read in order starting at offset 0, the decoded Bytes are written in order
+	 *
+	 * @param length of the compressed image including the header
+	 * @param read_end amount of Bytes read from the port, less than length if the image has trailing data
+	 */
+	template<uint32_t CHUNK_SIZE, typename Port>
+	BitstreamStreamResult stream(Port& port, uint32_t length, uint32_t& read_end)
+	{
+		uint8_t input[2][CHUNK_SIZE];
+		uint8_t output[CHUNK_SIZE];
+		uint8_t front = 0;
+
+		read_end = 0;
+		if(length < CODEC_HEADER_SIZE)
+		{
+			return STREAM_BAD_HEADER;
+		}
+
+		uint8_t header[CODEC_HEADER_SIZE];
+		uint32_t raw_length;
+		port.read(0, header, sizeof(header));
+		read_end = CODEC_HEADER_SIZE;
+		if(!BitstreamCodec::parseHeader(header, raw_length))
+		{
+			return STREAM_BAD_HEADER;
+		}
+		reset(raw_length);
+
+		uint32_t input_len = chunkAt(read_end, length, CHUNK_SIZE);
+		port.read(read_end, input[front], input_len);
+		read_end += input_len;
+
+		uint32_t input_pos = 0;
+		uint32_t output_len = 0;
+
+		while(!done())
+		{
+			uint32_t consumed;
+			uint32_t produced = decode(input[front] + input_pos, input_len - input_pos, consumed, output + output_len, CHUNK_SIZE - output_len);
+			output_len += produced;
+			input_pos += consumed;
+
+			/* A full output or a pending run or copy dont need input, only a decoder that is stuck does */
+			bool need_input = !done() && output_len < CHUNK_SIZE && produced == 0 && consumed == 0;
+			if(output_len < CHUNK_SIZE && !done() && !need_input)
+			{
+				continue;
+			}
+
+			uint32_t back_len = need_input ? chunkAt(read_end, length, CHUNK_SIZE) : 0;
+			port.readWhileWriting(read_end, input[front ^ 1], back_len, output, output_len);
+			output_len = 0;
+
+			if(need_input)
+			{
+				if(back_len == 0)
+				{
+					return STREAM_TRUNCATED;
+				}
+
+				front ^= 1;
+				input_len = back_len;
+				input_pos = 0;
+				read_end += back_len;
+			}
+		}
+
+		return STREAM_OK;
+	}
+
+	bool done() { return remaining_output == 0; }
+
+private:
+	enum State
+	{
+		CONTROL,
+		LITERAL,
+		RUN_LENGTH,
+		RUN_VALUE,
+		RUN,
+		DISTANCE,
+		COPY,
+	};
+
+	static constexpr uint32_t WINDOW_MASK = CODEC_WINDOW_SIZE - 1;
+
+	static uint32_t chunkAt(uint32_t offset, uint32_t length, uint32_t chunk_size)
+	{
+		return (length - offset < chunk_size) ? length - offset : chunk_size;
+	}
+
+	uint8_t window[CODEC_WINDOW_SIZE];
+	uint32_t window_pos = 0;
+	uint32_t remaining_output = 0;
+	uint32_t remaining_token = 0;
+	uint32_t distance = 0;
+	uint8_t value = 0;
+	State state = CONTROL;
+};
+
+#endif // BITSTREAMCODEC_H_
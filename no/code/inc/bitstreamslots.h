@@ -0,0 +1,96 @@
+#ifndef BITSTREAMSLOTS_H_
+#define BITSTREAMSLOTS_H_
+
+#include "mx25r6435f.h"
+#include "crc32.h"
+#include "bitstreamcodec.h"
+#include "logging.h"
+
+/* Sector right below the Flash test space */
+#define SLOT_TABLE_OFFSET 0x122000
+#define SLOT_TABLE_MAGIC 0x544F4C53 /* "SLOT" little endian */
+#define SLOT_COUNT 8
+
+/* Layout that is used if there is no valid table in the Flash */
+#define ICE40_FILESIZE 104090
+#define SIZE_ICE40_CONFIG 104096 /* Spacing of the images, ICE40_FILESIZE rounded up to 16 Bytes */
+
+enum BitstreamSlotID
+{
+	SLOT_EXP0 = 0,
+	SLOT_EXP1 = 1,
+	SLOT_EXP2 = 2,
+	SLOT_ISFD = 3,
+};
+
+enum BitstreamSlotFlags
+{
+	SLOT_FLAG_VALID = 1 << 0,
+	SLOT_FLAG_NO_CRC = 1 << 1,	/* Image has no known CRC, only set by the fixed layout */
+	SLOT_FLAG_COMPRESSED = 1 << 2,	/* Image is stored in the format of bitstreamcodec.h */
+};
+
+/**
+ * @brief One Bitstream in the Flash (16 Bytes, little endian)
+ */
+struct BitstreamSlot
+{
+	uint32_t offset;
+	uint32_t length;
+	uint32_t crc;		/* CRC32 (IEEE 802.3) over length Bytes at offset, as stored */
+	uint16_t version;
+	uint16_t flags;
+};
+
+/**
+ * @brief Header in front of the SLOT_COUNT entries at SLOT_TABLE_OFFSET
+ */
+struct BitstreamSlotTableHeader
+{
+	uint32_t magic;
+	uint32_t crc;		/* CRC32 over all entries */
+};
+
+/**
+ * @brief Directory of the ICE40 Bitstreams in the Flash, read once at boot and kept in RAM
+ */
+class BitstreamSlotTable
+{
+public:
+	BitstreamSlotTable(MX25R6435F& flash);
+
+	/**
+	 * @brief Reads the table from the Flash, falls back to the fixed layout if it is missing or corrupt
+	 *
+	 * @retval false if the fallback layout is used
+	 */
+	bool load();
+
+	/**
+	 * @retval the slot or nullptr if the id is out of range or the slot is empty
+	 */
+	const BitstreamSlot* get(uint8_t id);
+
+	/**
+	 * @brief Enters an image that is already in the Flash into the table, calculates its CRC
+	 * and stores the whole table in the Flash (blocking operation). Compressed images are
+	 * recognized by their header
+	 */
+	bool registerSlot(uint8_t id, uint32_t offset, uint32_t length, uint16_t version);
+
+	/**
+	 * @brief CRC32 over a Flash region, read in small chunks
+	 */
+	uint32_t calculateCRC(uint32_t offset, uint32_t length);
+
+private:
+	void loadDefaults();
+	void store();
+
+	MX25R6435F& flash;
+	BitstreamSlot slots[SLOT_COUNT];
+
+	static constexpr uint32_t CRC_CHUNK_SIZE = 256;
+};
+
+#endif // BITSTREAMSLOTS_H_
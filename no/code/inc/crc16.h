@@ -11,7 +11,11 @@ extern "C" {
 #endif
 
 
+/* Start value for crc16_ccitt_update() */
+#define CRC16_INIT 0xFFFF
+
 uint16_t crc16_ccitt(const uint8_t* buffer, size_t size);
+uint16_t crc16_ccitt_update(uint16_t crc, const uint8_t* buffer, size_t size);
 
 
 #ifdef __cplusplus                                                                                                       
@@ -0,0 +1,27 @@
+// crc32.h
+
+#ifndef _CRC32_H_
+#define _CRC32_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus                                                                                                       
+extern "C" {                                                                                                             
+#endif
+
+/* Start value for crc32_update(), the result has to be inverted with crc32_final() */
+#define CRC32_INIT 0xFFFFFFFF
+
+uint32_t crc32(const uint8_t* buffer, size_t size);
+uint32_t crc32_update(uint32_t crc, const uint8_t* buffer, size_t size);
+uint32_t crc32_final(uint32_t crc);
+
+
+#ifdef __cplusplus                                                                                                       
+}
+#endif
+
+#endif // _CRC32_H_
+
+// EOF
@@ -12,7 +12,7 @@ class ExpTest: public Experiment
 {
 public:
     ExpTest(SensorContext& sensorcontext, ICE40PROG& programmer, MemoryContext& memorycontext, Serial& iceUART) :
-	Experiment(sensorcontext, programmer, memorycontext, iceUART), timer1(TimerID::TIMER1){}
+	Experiment(sensorcontext, programmer, memorycontext, iceUART, "exptest"), timer1(TimerID::TIMER1){}
 
 	bool init()
 	{		
@@ -23,15 +23,12 @@ public:
 		timer1.start();
 
 		/* ICE40 Programming (ring oscillator GATEMATE GPIO: IO_SA_A3 & IO_SA)*/
-		SPI ice40_spi(SPIDevice::ICE40);
-		ice40_spi.init(1, 0);
-		ICE40PROG ice40prog(memory.flash, ice40_spi);
 		sensors.dac.setOutputVoltagerange(MAX_2V5); //toDo
 		sensors.dac.setVoltage(1200);
 		sensors.enableICE40OSC(true);
 		sensors.enableICE40VCORE(true);
 		sensors.enableICE40VIO(true);
-		ice40prog.programm(USERSPACE_OFFSET); //toDo
+		programmer.programm(SLOT_EXP0); //toDo
 
 		sensors.temp1.readTempC();
 		sensors.temp2.readTempC();
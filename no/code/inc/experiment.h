@@ -4,6 +4,10 @@
 #include "sensorcontext.h"
 #include "memorycontext.h"
 #include "ice40prog.h"
+#include "recordwriter.h"
+
+/* HyperRAM region every experiment gets for its results */
+#define EXPERIMENT_RESULTS_SIZE 0x10000
 
 enum ExperimentState
 {
@@ -15,17 +19,30 @@ enum ExperimentState
 class Experiment
 {
 public:
-	Experiment(SensorContext &sensorcontext, ICE40PROG &programmer, MemoryContext &memorycontext, Serial &iceUART) 
-	: sensors(sensorcontext), programmer(programmer), memory(memorycontext), iceUART(iceUART) {}
+	/**
+	 * @param name of the HyperRAM region with the results of the experiment
+	 */
+	Experiment(SensorContext &sensorcontext, ICE40PROG &programmer, MemoryContext &memorycontext, Serial &iceUART, const char* name) 
+	: sensors(sensorcontext), programmer(programmer), memory(memorycontext), iceUART(iceUART),
+	results(memorycontext.arena.allocate(name, EXPERIMENT_RESULTS_SIZE)), record(results) {}
 	virtual bool init() = 0;
 	virtual ExperimentState run() = 0;
 	virtual bool cleanUp() = 0;
 
+	/**
+	 * @brief Region with the results, everything recorded so far is flushed to it
+	 */
+	HyperRamRegion* getResults() { record.flush(); return results; }
+
 protected:
 	SensorContext &sensors;
 	ICE40PROG &programmer;
 	MemoryContext &memory;
 	Serial &iceUART;
+	HyperRamRegion* results;
+
+	/* Writes the results as records of resultrecord.h */
+	RecordWriter record;
 };
 
 #endif // EXPERIMENT_H_
\ No newline at end of file
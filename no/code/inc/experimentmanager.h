@@ -24,8 +24,8 @@ public:
 	 */
 	bool runCurrentExperiment();
 
-	Experiment *current_experiment;
-	ExperimentState cur_state;
+	Experiment *current_experiment = nullptr;
+	ExperimentState cur_state = ExperimentState::TEST_FINISHED;
 
 private:
 	
@@ -0,0 +1,87 @@
+#ifndef FLASHJOBQUEUE_H_
+#define FLASHJOBQUEUE_H_
+
+#include "mx25r6435f.h"
+
+/* Must be a power of 2, a MEMORY_WRITE_DATA chunk of up to 1 KB spans 5 pages and has to fit at once */
+#define FLASH_JOB_QUEUE_DEPTH 8
+
+enum FlashJobType
+{
+	FLASH_JOB_PROGRAM,
+	FLASH_JOB_ERASE,
+};
+
+struct FlashJob;
+
+/**
+ * @brief Called from FlashJobQueue::poll() once a job has finished, the job is only valid during the call
+ */
+typedef void (*FlashJobCallback)(const FlashJob& job, void* context);
+
+struct FlashJob
+{
+	uint8_t type;
+	uint32_t address;
+	uint32_t len;
+	FlashJobCallback callback;
+	void* context;
+	uint8_t data[MX25R6435F::PAGE_SIZE];	/* Copy of the data to be programmed, the caller may reuse its buffer */
+};
+
+/**
+ * @brief Queue of page program and erase jobs that are worked off from the main loop,
+ * poll() never waits for the flash, so SIP traffic and experiments overlap with the flash busy time
+ */
+class FlashJobQueue
+{
+public:
+	FlashJobQueue(MX25R6435F& flash);
+
+	/**
+	 * @brief Queues programming len bytes at address, split at the page boundaries.
+	 * The callback is called once the last page has been programmed
+	 *
+	 * @retval false if there are not enough free slots, nothing is queued then
+	 */
+	bool submitProgram(uint32_t address, const uint8_t* data, uint32_t len, FlashJobCallback callback = nullptr, void* context = nullptr);
+
+	/**
+	 * @brief Queues erasing [address, address + len) (see ErasePlan)
+	 *
+	 * @retval false if the queue is full
+	 */
+	bool submitErase(uint32_t address, uint32_t len, FlashJobCallback callback = nullptr, void* context = nullptr);
+
+	/**
+	 * @brief Starts the next job or checks the running one for completion, to be called from the main loop
+	 */
+	void poll();
+
+	/**
+	 * @brief Polls till at least the given amount of slots is free (blocking operation)
+	 */
+	void waitForSlots(uint32_t slots);
+
+	/**
+	 * @brief Polls till all jobs are done (blocking operation)
+	 */
+	void waitIdle();
+
+	uint32_t freeSlots() { return FLASH_JOB_QUEUE_DEPTH - count; }
+	bool isIdle() { return count == 0; }
+
+private:
+	FlashJob& push();
+
+	MX25R6435F& flash;
+
+	FlashJob jobs[FLASH_JOB_QUEUE_DEPTH];
+	uint8_t head = 0;
+	uint8_t count = 0;
+	bool started = false;
+
+	static constexpr uint8_t QUEUE_MASK = FLASH_JOB_QUEUE_DEPTH - 1;
+};
+
+#endif // FLASHJOBQUEUE_H_
@@ -0,0 +1,125 @@
+#ifndef FLASHJOURNAL_H_
+#define FLASHJOURNAL_H_
+
+#include "stdint.h"
+#include "mx25r6435f.h"
+#include "flashjobqueue.h"
+#include "hyperramarena.h"
+#include "crc32.h"
+#include "logging.h"
+#include "resultrecord.h"
+
+/* Ring of sectors in the upper half of the flash, above all Bitstream slots */
+#define JOURNAL_OFFSET 0x600000
+#define JOURNAL_SECTORS 256
+#define JOURNAL_PAGES_PER_SECTOR (SECTOR_SIZE / MX25R6435F::PAGE_SIZE)
+#define JOURNAL_PAGES (JOURNAL_SECTORS * JOURNAL_PAGES_PER_SECTOR)
+
+#define JOURNAL_MAGIC 0x4C4A /* "JL" little endian */
+#define JOURNAL_MAX_STREAMS 4
+
+/* Set on the first page after the region has been cleared */
+#define JOURNAL_FLAG_RESTART (1 << 0)
+
+/**
+ * @brief Header in front of the payload of every journal page (20 Bytes)
+ */
+struct JournalPageHeader
+{
+	uint16_t magic;
+	uint8_t stream;
+	uint8_t flags;
+	uint32_t sequence;		/* Increases with every page, the highest one is the tail of the journal */
+	uint32_t offset;		/* Position of the payload in the region */
+	uint16_t length;
+	uint16_t reserved;
+	uint32_t crc;			/* CRC32 over header (with crc = 0) and payload */
+};
+
+#define JOURNAL_PAYLOAD_SIZE (MX25R6435F::PAGE_SIZE - sizeof(JournalPageHeader))
+
+/**
+ * @brief Log structured copy of HyperRAM regions in the flash, so the results survive a power cycle.
+ * New data of a region is appended page by page to a ring of sectors, every page carries a sequence number
+ * and a CRC so the tail can be found again and torn pages are ignored.
+ * All flash accesses go through the FlashJobQueue, poll() queues at most one page (or the erase of the
+ * next sector) at a time and only full pages, partial pages are only written by flush()
+ */
+class FlashJournal
+{
+public:
+	FlashJournal(MX25R6435F& flash, FlashJobQueue& jobs);
+
+	/**
+	 * @brief Mirrors the region under the given stream id, the id has to stay the same across boots
+	 *
+	 * @retval false if the id is already used or out of range
+	 */
+	bool track(uint8_t stream, HyperRamRegion* region);
+
+	/**
+	 * @brief Finds the tail of the journal, has to be called once at boot before anything is appended
+	 */
+	void recover();
+
+	/**
+	 * @brief Copies the journal back into the tracked regions, from the oldest to the newest page.
+	 * The restored data is not journaled again. If the start of a region has already been dropped
+	 * from the ring, that part is filled with RECORD_PAD, so the decoder skips it and goes on with the restored records
+	 *
+	 * @retval amount of restored pages
+	 */
+	uint32_t restore();
+
+	/**
+	 * @brief Queues the next full page of new data, to be called from the main loop.
+	 * Never waits for the flash
+	 */
+	void poll();
+
+	/**
+	 * @brief Writes everything that is not in the journal yet, including partial pages,
+	 * and waits till it has been programmed (blocking operation)
+	 */
+	void flush();
+
+	uint32_t getSequence() { return sequence; }
+	uint32_t getHeadPage() { return head_page; }
+
+private:
+	struct Stream
+	{
+		HyperRamRegion* region = nullptr;
+		uint32_t mirrored = 0;		/* Bytes of the region that are in the journal */
+		uint32_t generation = 0;	/* Generation of the region when mirrored was taken */
+		bool restart = false;
+	};
+
+	/**
+	 * @brief Queues one page with the next data of the stream
+	 *
+	 * @param partial also write a page that isnt full
+	 * @retval true if a page (or the erase in front of it) has been queued
+	 */
+	bool appendPage(Stream& stream, uint8_t id, bool partial);
+
+	/**
+	 * @retval true if the page holds a valid header and payload, header is filled in anyway
+	 */
+	bool readPage(uint32_t page, JournalPageHeader& header, uint8_t* payload);
+
+	bool isErased(uint32_t page);
+	uint32_t pageAddress(uint32_t page) { return JOURNAL_OFFSET + page * MX25R6435F::PAGE_SIZE; }
+
+	MX25R6435F& flash;
+	FlashJobQueue& jobs;
+
+	Stream streams[JOURNAL_MAX_STREAMS];
+	uint8_t next_stream = 0;
+
+	uint32_t head_page = 0;		/* Next page to be programmed */
+	uint32_t sequence = 0;
+	bool head_erased = false;	/* The sector of head_page has been erased */
+};
+
+#endif // FLASHJOURNAL_H_
@@ -0,0 +1,182 @@
+#ifndef FLASHSCANENGINE_H_
+#define FLASHSCANENGINE_H_
+
+#include <stdint.h>
+#include "scanpattern.h"
+
+/**
+ * @brief Streams a flash region through a double buffered window and compares it
+ * against the generated reference pattern (see ScanPattern), the pattern itself is never stored
+ *
+ * While the next chunk is read into the back buffer byte by byte, the front buffer is compared
+ * one word per received byte, so the compare runs while the SPI shifts in the data.
+ * Kept free of any Hardware includes like ScanPattern, Flash has to provide
+ * beginRead(address), readNext(more), endRead() (see MX25R6435F) and write(address, data, len)
+ */
+template<typename Flash>
+class FlashScanEngine
+{
+public:
+	/**
+	 * @param flash the flash that is to be scanned
+	 * @param sink receives every mismatching byte, may be nullptr if only the count is of interest
+	 */
+	FlashScanEngine(Flash& flash, ScanMismatchSink* sink = nullptr) : flash(flash), sink(sink) {}
+
+	/**
+	 * @brief Starts a new scan pass over the given region, start and length get aligned to 4 Bytes
+	 */
+	void begin(uint32_t new_start, uint32_t new_length, uint32_t new_seed)
+	{
+		/* The compare runs on whole words */
+		start = new_start & ~0x03;
+		length = (new_length + (new_start - start) + 3) & ~0x03;
+		seed = new_seed;
+		offset = 0;
+		pass_mismatches = 0;
+		front = 0;
+
+		active = (length > 0);
+		if(active)
+		{
+			/* Nothing to compare yet, the first chunk is read on its own */
+			transfer(buffers[front], 0, chunkLength(0), nullptr, 0, 0);
+		}
+	}
+
+	/**
+	 * @brief Scans the next chunk of the current pass, meant to be called from an Experiment run()
+	 *
+	 * @retval true if the pass is finished, false if there are chunks left
+	 */
+	bool step()
+	{
+		if(!active)
+		{
+			return true;
+		}
+
+		uint32_t front_len = chunkLength(offset);
+		uint32_t next_offset = offset + front_len;
+
+		/* Reads the next chunk into the back buffer while the front one gets compared */
+		transfer(buffers[front ^ 1], next_offset, chunkLength(next_offset), buffers[front], offset, front_len / sizeof(uint32_t));
+
+		offset = next_offset;
+		front ^= 1;
+
+		if(offset >= length)
+		{
+			active = false;
+			pass++;
+			return true;
+		}
+
+		return false;
+	}
+
+	/**
+	 * @brief Runs a whole pass over the region given to begin() (blocking operation)
+	 *
+	 * @retval amount of mismatching bytes in this pass
+	 */
+	uint32_t scan()
+	{
+		while(!step());
+
+		return pass_mismatches;
+	}
+
+	/**
+	 * @brief Writes the reference pattern into the flash, the region has to be erased already
+	 */
+	void programPattern(uint32_t new_start, uint32_t new_length, uint32_t new_seed)
+	{
+		uint32_t aligned_start = new_start & ~0x03;
+		uint32_t aligned_length = (new_length + (new_start - aligned_start) + 3) & ~0x03;
+
+		for(uint32_t written = 0; written < aligned_length; written += CHUNK_SIZE)
+		{
+			uint32_t chunk_len = (aligned_length - written < CHUNK_SIZE) ? aligned_length - written : CHUNK_SIZE;
+
+			ScanPattern::fill(buffers[0], aligned_start + written, chunk_len / sizeof(uint32_t), new_seed);
+			flash.write(aligned_start + written, reinterpret_cast<uint8_t*>(buffers[0]), chunk_len);
+		}
+	}
+
+	uint32_t getPass() { return pass; }
+	uint32_t getPassMismatches() { return pass_mismatches; }
+	uint32_t getScannedBytes() { return offset; }
+	bool isActive() { return active; }
+
+	/* Must be a multiple of 4 */
+	static constexpr uint32_t CHUNK_SIZE = 512;
+
+private:
+	/**
+	 * @retval length of the chunk at chunk_offset (relative to the region start), 0 behind the region
+	 */
+	uint32_t chunkLength(uint32_t chunk_offset)
+	{
+		if(chunk_offset >= length)
+		{
+			return 0;
+		}
+
+		return (length - chunk_offset < CHUNK_SIZE) ? length - chunk_offset : CHUNK_SIZE;
+	}
+
+	/**
+	 * @brief Reads read_len bytes at read_offset into dst and compares the words of data at compare_offset
+	 * in the meantime, one word per received byte. Words that are left are compared afterwards
+	 */
+	void transfer(uint32_t* dst, uint32_t read_offset, uint32_t read_len, const uint32_t* data, uint32_t compare_offset, uint32_t words)
+	{
+		uint8_t* back = reinterpret_cast<uint8_t*>(dst);
+		uint32_t address = start + compare_offset;
+		uint32_t word = 0;
+
+		if(read_len)
+		{
+			flash.beginRead(start + read_offset);
+
+			for(uint32_t i = 0; i < read_len; i++)
+			{
+				/* The flash shifts in byte i in the meantime */
+				if(word < words)
+				{
+					pass_mismatches += ScanPattern::compareWord(data[word], address + (word << 2), seed, pass, sink);
+					word++;
+				}
+
+				back[i] = flash.readNext(i + 1 < read_len);
+			}
+
+			flash.endRead();
+		}
+
+		if(word < words)
+		{
+			pass_mismatches += ScanPattern::compare(&data[word], address + (word << 2), words - word, seed, pass, sink);
+		}
+	}
+
+	static constexpr uint32_t CHUNK_WORDS = CHUNK_SIZE / sizeof(uint32_t);
+
+	Flash& flash;
+	ScanMismatchSink* sink;
+
+	uint32_t buffers[2][CHUNK_WORDS];
+	uint8_t front = 0;
+
+	uint32_t start = 0;
+	uint32_t length = 0;
+	uint32_t seed = 0;
+	uint32_t offset = 0;
+
+	uint32_t pass = 0;
+	uint32_t pass_mismatches = 0;
+	bool active = false;
+};
+
+#endif // FLASHSCANENGINE_H_
@@ -0,0 +1,136 @@
+#ifndef HYPERRAMARENA_H_
+#define HYPERRAMARENA_H_
+
+#include "stdint.h"
+#include "logging.h"
+
+#define HYPER_RAM_SIZE 8000000
+#define ARENA_MAX_REGIONS 16
+#define ARENA_NAME_SIZE 16
+
+/* Regions start and end on word boundaries */
+#define ARENA_ALIGNMENT 4
+
+/**
+ * @brief Named, bounded part of the HyperRAM, handed out by the HyperRamArena.
+ * Data can be appended behind the used part, writes past the end are dropped and counted
+ */
+class HyperRamRegion
+{
+public:
+	/**
+	 * @brief Appends a byte behind the used part
+	 *
+	 * @retval false if the region is full, the byte is dropped then
+	 */
+	bool push(uint8_t byte)
+	{
+		if(used >= size)
+		{
+			overflows++;
+			return false;
+		}
+
+		data[used++] = byte;
+		return true;
+	}
+
+	/**
+	 * @brief Reserves len bytes behind the used part (bump allocation)
+	 *
+	 * @retval start of the reserved bytes or nullptr if they dont fit anymore
+	 */
+	volatile uint8_t* reserve(uint32_t len)
+	{
+		if(len > size - used)
+		{
+			overflows++;
+			return nullptr;
+		}
+
+		volatile uint8_t* start = data + used;
+		used += len;
+		return start;
+	}
+
+	/**
+	 * @brief Marks the whole region as unused, the content stays as it is
+	 */
+	void clear() { used = 0; overflows = 0; generation++; }
+
+	volatile uint8_t* getData() { return data; }
+	const char* getName() { return name; }
+	uint32_t getOffset() { return offset; }
+	uint32_t getSize() { return size; }
+	uint32_t getUsed() { return used; }
+	uint32_t getFree() { return size - used; }
+	uint32_t getOverflows() { return overflows; }
+
+	/**
+	 * @brief Changes with every clear(), so a clear is noticed even if the region has grown again since
+	 */
+	uint32_t getGeneration() { return generation; }
+
+private:
+	friend class HyperRamArena;
+	friend class HyperRamWriter;
+	friend class FlashJournal;
+
+	char name[ARENA_NAME_SIZE] = {0};
+	volatile uint8_t* data = nullptr;
+	uint32_t offset = 0;	/* Relative to the start of the HyperRAM */
+	uint32_t size = 0;
+	uint32_t used = 0;
+	uint32_t overflows = 0;
+	uint32_t generation = 0;
+};
+
+/**
+ * @brief Hands out the HyperRAM as named regions in bump allocation, so every user
+ * gets its own bounded part instead of a hardcoded offset
+ */
+class HyperRamArena
+{
+public:
+	HyperRamArena(volatile uint8_t* base, uint32_t size);
+
+	/**
+	 * @brief Hands out a new region, a region that already exists under that name is handed out again.
+	 * Never returns nullptr, if the HyperRAM is used up an empty region is returned that drops every write
+	 *
+	 * @param name at most ARENA_NAME_SIZE - 1 characters
+	 */
+	HyperRamRegion* allocate(const char* name, uint32_t size);
+
+	/**
+	 * @retval region with the given name or nullptr if there is none
+	 */
+	HyperRamRegion* find(const char* name);
+
+	/**
+	 * @retval region that overlaps [offset, offset + len) or nullptr if the range only covers free HyperRAM
+	 */
+	HyperRamRegion* findOverlap(uint32_t offset, uint32_t len);
+
+	uint32_t getRegionCount() { return region_count; }
+	HyperRamRegion* getRegion(uint32_t index) { return (index < region_count) ? &regions[index] : nullptr; }
+	uint32_t getFree() { return size - top; }
+
+	/**
+	 * @brief Logs all regions with their bounds and usage
+	 */
+	void printLayout();
+
+private:
+	volatile uint8_t* base;
+	uint32_t size;
+	uint32_t top = 0;
+
+	HyperRamRegion regions[ARENA_MAX_REGIONS];
+	uint32_t region_count = 0;
+
+	/* Handed out if the arena is full */
+	HyperRamRegion overflow_region;
+};
+
+#endif // HYPERRAMARENA_H_
@@ -0,0 +1,62 @@
+#ifndef HYPERRAMWRITER_H_
+#define HYPERRAMWRITER_H_
+
+#include "stdint.h"
+#include "hyperramarena.h"
+
+/**
+ * @brief Appends typed records to a HyperRamRegion with 32 bit stores.
+ * Bytes are collected in a register till a word is complete, so the HyperRAM sees one
+ * Wishbone access per 4 Bytes instead of one per Byte. The Byte order in the region is the
+ * same as with single Byte pushes, values are stored MSB first
+ */
+class HyperRamWriter
+{
+public:
+	HyperRamWriter(HyperRamRegion* region) : region(region) {}
+
+	void put8(uint8_t value);
+	void put16(uint16_t value);
+	void put32(uint32_t value);
+
+	/**
+	 * @brief Stores the IEEE 754 bit pattern of the value, MSB first like put32()
+	 */
+	void putFloat(float value);
+
+	/**
+	 * @brief Copies a Byte array, whole words are stored back to back so the controller can burst them
+	 */
+	void putBytes(const uint8_t* src, uint32_t len);
+
+	/**
+	 * @brief Stores the incomplete word, has to be called before the region is read.
+	 * Further writes continue in the same word
+	 */
+	void flush();
+
+	/**
+	 * @brief Clears the region and starts writing at its beginning
+	 */
+	void reset();
+
+	/**
+	 * @retval written Bytes, including the ones that are not flushed yet
+	 */
+	uint32_t getUsed() { return position; }
+
+private:
+	/**
+	 * @brief Takes over the current end of the region, it might have been written through the region itself
+	 */
+	void sync();
+	void storeWord();
+
+	HyperRamRegion* region;
+
+	uint32_t word = 0;		/* Collects the Bytes of the word at position & ~3 */
+	uint32_t position = 0;
+	bool synced = false;
+};
+
+#endif // HYPERRAMWRITER_H_
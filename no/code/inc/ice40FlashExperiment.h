@@ -5,51 +5,78 @@
 #include "timer.h"
 #include "logging.h"
 #include "gpio.h"
+#include "flashscanengine.h"
+#include "bitflipclassifier.h"
+#include "flashjobqueue.h"
 
 #define EXPERIMENT_ID 4
 
-
+/* The flash on the ICE40 SPI is scanned against the reference pattern, its last sector holds the marker */
+#define SCAN_START 0
+#define SCAN_LENGTH (MX25R6435F::FLASH_SIZE - SECTOR_SIZE)
+#define SCAN_MARKER_ADDRESS (MX25R6435F::FLASH_SIZE - SECTOR_SIZE)
+#define SCAN_MARKER_MAGIC 0x4E414353 /* "SCAN" little endian */
+#define SCAN_SEED 0x2545F491
+#define SCAN_PASSES 3
 
 class ICE40FlashExperiment: public Experiment
 {
 public:
     ICE40FlashExperiment(SensorContext& sensorcontext, ICE40PROG& programmer, MemoryContext& memorycontext, Serial& iceUART) :
-	Experiment(sensorcontext, programmer, memorycontext, iceUART), timer1(TimerID::TIMER1), ice40_spi(SPIDevice::ICE40){}
+	Experiment(sensorcontext, programmer, memorycontext, iceUART, "ice40flash"), timer1(TimerID::TIMER1), ice40_spi(SPIDevice::ICE40),
+	test_flash(ice40_spi), pattern_jobs(test_flash), classifier(memorycontext), scanner(test_flash, &classifier){}
 
 	bool init();
 	ExperimentState run();
 	bool cleanUp();
 
 private:
+	/* The pattern is prepared in steps from run(), so SIP and the flash journal keep running meanwhile */
+	enum ScanPhase
+	{
+		PHASE_ERASE,
+		PHASE_PROGRAM,
+		PHASE_MARKER,
+		PHASE_SCAN,
+	};
+
 	Timer timer1;
     SPI ice40_spi;
+	MX25R6435F test_flash;
+	FlashJobQueue pattern_jobs;
+	BitFlipClassifier classifier;
+	FlashScanEngine<MX25R6435F> scanner;
 	uint16_t experimentTimeS = 0;
 	uint32_t timeNextEvent = 0;
 	uint32_t expStartTime = 0;
 
 	uint64_t startTime;
-	uint64_t endTime;
 
-	uint32_t initialTimerValue = 0;
-	uint32_t currentTimerValue  = 0;
-	uint64_t elapsedTicks;
+	ScanPhase phase = PHASE_SCAN;
+	/* Next address of the scanned region that gets the pattern queued */
+	uint32_t program_offset = 0;
 
-	uint16_t ramPos=0;
+	/**
+	 * @brief Checks the marker and starts erasing the scanned region, unless the pattern
+	 * with SCAN_SEED is already there
+	 */
+	void beginPattern(void);
 
-    uint8_t flashBuff[8192];
+	/**
+	 * @brief Advances the erase and the queued page programs of the pattern (non-blocking)
+	 *
+	 * @retval true once the pattern and its marker are in the flash
+	 */
+	bool preparePattern(void);
+
+	/**
+	 * @brief Records the result of the pass that has just been finished
+	 */
+	void recordPass(void);
 
-	bool makeTest(void);
-	
 	void readingSensors(void);
 	void delayms(uint32_t timeout);
 	uint32_t runningTime(void);
-	void hyperramAddUint8_t(uint8_t data);
-	void hyperramAddUint16_t(uint16_t data);
-	void hyperramAddUint32_t(uint32_t data);
-
-    void writeAddress(uint32_t address);
-    uint32_t readID();
-    void read(uint32_t address, uint32_t len);
 
 };
 
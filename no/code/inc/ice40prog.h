@@ -7,40 +7,54 @@
 #include "mx25r6435f.h"
 #include "logging.h"
 #include "memorycontext.h"
+#include "bitstreamslots.h"
 
-#define SIZE_ICE40_CONFIG 104096
-
-enum CONFIG_OFFSETS
-{
-	//BLINKY_TEST = USERSPACE_OFFSET + 0,
-	Exp0 = USERSPACE_OFFSET + 0 * SIZE_ICE40_CONFIG, 	//0x124F80
-	Exp1 = USERSPACE_OFFSET + 1 * SIZE_ICE40_CONFIG,	//0x13E620
-	Exp2 = USERSPACE_OFFSET + 2 * SIZE_ICE40_CONFIG,	//0x157CC0
-};
-
-/* Last Megabyte is reserved for this code */
-#define RESERVED_HYPERRAM 7000000
+/* HyperRAM region the image is staged in, see programm() */
 #define RESERVED_SIZE 1000000
 
-#define ICE40_FILESIZE 104090
-
 class ICE40PROG
 {
 public:
 	/**
-	 * @param flash a Driver to the Flash of the device
+	 * @param memory provides the Flash of the device and the HyperRAM for staged images
 	 * @param ice40spi SPI Connection to the ICE40 Programming Pins
 	 */
-	ICE40PROG(MX25R6435F& flash, SPI& ice40spi);
+	ICE40PROG(MemoryContext& memory, SPI& ice40spi);
 
 	/**
-	 * @brief Programms the ICE40 with the data in the flash given by
-	 * the flash_start_address and the length of the bitstream following that address
+	 * @brief Programms the ICE40 with the Bitstream in the given slot (see BitstreamSlotTable),
+	 * only the real image length is transferred and an image with a wrong CRC is rejected.
+	 * Nothing is done if the ICE40 is still configured with the same image
+	 *
+	 * @param force reprogram even if the image is already loaded
+	 * @param staged copy the image to the HyperRAM first, else it is streamed from the flash directly
+	 * into the ICE40 while the next chunk is already read. Compressed images are always streamed
+	 * @retval true if CDONE went high
 	 */
-	void programm(uint32_t flash_start_address);
+	bool programm(uint8_t slot_id, bool force = false, bool staged = false);
+
+	/**
+	 * @brief Forgets the loaded image, the next programm() always configures the ICE40
+	 */
+	void invalidate() { loaded = false; }
+
+	BitstreamSlotTable slots;
 
 private:
-	void sendConfig();
+	void sendConfig(uint32_t length);
+
+	/**
+	 * @brief Sends the image straight from the flash, double buffered in STREAM_CHUNK_SIZE chunks
+	 *
+	 * @retval false if the CRC of the sent image doesnt match
+	 */
+	bool streamConfig(const BitstreamSlot& slot);
+
+	/**
+	 * @brief Same as streamConfig() for a compressed image, it is decoded into the SPI stream
+	 * while the next compressed chunk is read
+	 */
+	bool streamCompressedConfig(const BitstreamSlot& slot);
 	void sendZeroes(uint32_t zeroes);
 	void sendDummyBytes(uint32_t bytes);
 	void cresetHigh();
@@ -48,13 +62,26 @@ private:
 
 	bool cdoneRead();
 
-	MX25R6435F flash;
+	/**
+	 * @brief Checks if the ICE40 still holds the image of the slot, only images with a known CRC are cached
+	 */
+	bool isLoaded(uint8_t slot_id, const BitstreamSlot& slot);
+
+	MX25R6435F& flash;
 	SPI ice40spi;
 
-	volatile uint8_t *reserved_ram = (uint8_t*)(HYPER_RAM_BASE + RESERVED_HYPERRAM);
+	/* Last image that has been loaded successfully */
+	bool loaded = false;
+	uint8_t loaded_slot = 0;
+	uint32_t loaded_crc = 0;
+
+	HyperRamRegion* staging;
 	static constexpr uint32_t dummy_bits = 49;
 	static constexpr uint32_t dummy_bytes = (dummy_bits / 8) + 1;
 	static constexpr uint32_t reads_per_run = 8;
+	static constexpr uint32_t STREAM_CHUNK_SIZE = 256;
+
+	BitstreamDecoder decoder;
 };
 
 #endif /* _ICE40PROG_H_ */
\ No newline at end of file
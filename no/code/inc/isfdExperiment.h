@@ -57,7 +57,7 @@ class ISFDExperiment: public Experiment
 {
 public:
     ISFDExperiment(SensorContext& sensorcontext, ICE40PROG& programmer, MemoryContext& memorycontext, Serial& iceUART) :
-	Experiment(sensorcontext, programmer, memorycontext, iceUART), timer1(TimerID::TIMER1){}
+	Experiment(sensorcontext, programmer, memorycontext, iceUART, "isfd"), timer1(TimerID::TIMER1){}
 
 	bool init();
 	ExperimentState run();
@@ -87,7 +87,6 @@ private:
 
 	uint32_t A;
 
-	uint16_t ramPos=0;
 
 	
 
@@ -102,9 +101,6 @@ private:
 	void readingSensors(void);
 	void delayms(uint32_t timeout);
 	uint32_t runningTime(void);
-	void hyperramAddUint8_t(uint8_t data);
-	void hyperramAddUint16_t(uint16_t data);
-	void hyperramAddUint32_t(uint32_t data);
 
 };
 
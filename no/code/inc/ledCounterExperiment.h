@@ -10,7 +10,7 @@ class LedCounterExperiment: public Experiment
 {
 public:
     LedCounterExperiment(SensorContext& sensorcontext, ICE40PROG& programmer, MemoryContext& memorycontext, Serial& iceUART) : 
-	Experiment(sensorcontext, programmer, memorycontext, iceUART), timer1(TimerID::TIMER1)
+	Experiment(sensorcontext, programmer, memorycontext, iceUART, "ledcounter"), timer1(TimerID::TIMER1)
     {
         
     }
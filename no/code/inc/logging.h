@@ -1,35 +1,171 @@
 #ifndef LOGGING_H_
 #define LOGGING_H_
 
-#include "serial.h"
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
 
+/* Only the logging itself needs the UART, users of the macros stay free of hardware includes */
+class Serial;
+
 void setupLogging(Serial* serial);
 
 void log(const char* prefix, const char* file, const char* function, uint32_t line, const char* format, ...);
 void print(const char* format, ...);
 
+/* Highest level that is compiled in, the levels of the modules can only be lowered at runtime */
 #define LOG_LEVEL 3
 
+#define LOG_LEVEL_OFF 0
+#define LOG_LEVEL_WARN 1
+#define LOG_LEVEL_TEST 2
+#define LOG_LEVEL_INFO 3
+
+/*
+ * Every source file logs for one module, it is chosen by defining LOG_MODULE before the includes,
+ * files without one log for LOG_MODULE_CORE
+ */
+enum LogModule
+{
+	LOG_MODULE_CORE,
+	LOG_MODULE_SIP,
+	LOG_MODULE_MEMORY,
+	LOG_MODULE_SENSORS,
+	LOG_MODULE_RISCV,
+	LOG_MODULE_UVVMIN,
+	LOG_MODULE_ISFD,
+	LOG_MODULE_ICE40FLASH,
+	LOG_MODULE_COUNT,
+};
+
+#define LOG_MODULE_ALL 0xFF
+
+#ifndef LOG_MODULE
+#define LOG_MODULE LOG_MODULE_CORE
+#endif
+
+/* Current level of every module, a disabled call site costs one load and compare */
+extern uint8_t log_levels[LOG_MODULE_COUNT];
+
+/**
+ * @brief Sets the runtime level of a module, LOG_MODULE_ALL sets all of them
+ *
+ * @retval false if the module or level is unknown
+ */
+bool logSetLevel(uint8_t module, uint8_t level);
+
+/*
+ * Binary logging, enabled with "make LOG_BINARY=1"
+ *
+ * Every call site puts "LEVEL\0file:line\0format" into the .logfmt section, which is not loaded
+ * onto the target, the address of that entry is the ID of the message. Only the ID and the raw
+ * arguments are packed into a RAM ring, the ring is drained into the UART TX buffer from log
+ * calls and logPoll(). logdecode.py expands the records with the .logfmt section of demo.elf.
+ *
+ * Record:	LOG_SYNC, ID (uint16), payload length (uint8), payload, all little endian
+ * Payload:	integers up to 32 bit and pointers as 4 Bytes, 64 bit integers as 8 Bytes,
+ *			floats as 8 Byte double, strings as length (uint8) followed by at most LOG_STRING_MAX Bytes
+ */
+#ifndef LOG_BINARY
+#define LOG_BINARY 0
+#endif
+
+#define LOG_SYNC 0xA5
+#define LOG_RECORD_HEADER 4
+#define LOG_RECORD_MAX 128
+#define LOG_STRING_MAX 32
+#define LOG_RING_SIZE 1024
+
+/**
+ * @brief Copies a packed record into the ring, it is dropped and counted if the ring is full
+ */
+void logPush(uint8_t* record, uint32_t length);
+
+/**
+ * @brief Moves whole records from the ring into the UART TX buffer as far as they fit (non-blocking)
+ */
+void logPoll();
+
+inline void logPack(uint8_t* record, uint32_t& length, const void* value, uint32_t size)
+{
+	if(length + size <= LOG_RECORD_MAX)
+	{
+		memcpy(&record[length], value, size);
+		length += size;
+	}
+}
+
+inline void logPackWord(uint8_t* record, uint32_t& length, uint32_t value) { logPack(record, length, &value, sizeof(value)); }
+
+/* Smaller types are promoted to int, just like for printf */
+inline void logPack(uint8_t* record, uint32_t& length, int value) { logPackWord(record, length, value); }
+inline void logPack(uint8_t* record, uint32_t& length, unsigned int value) { logPackWord(record, length, value); }
+inline void logPack(uint8_t* record, uint32_t& length, long value) { logPackWord(record, length, value); }
+inline void logPack(uint8_t* record, uint32_t& length, unsigned long value) { logPackWord(record, length, value); }
+inline void logPack(uint8_t* record, uint32_t& length, long long value) { logPack(record, length, &value, sizeof(value)); }
+inline void logPack(uint8_t* record, uint32_t& length, unsigned long long value) { logPack(record, length, &value, sizeof(value)); }
+inline void logPack(uint8_t* record, uint32_t& length, double value) { logPack(record, length, &value, sizeof(value)); }
+inline void logPack(uint8_t* record, uint32_t& length, const void* value) { logPackWord(record, length, (uintptr_t)value); }
+
+inline void logPack(uint8_t* record, uint32_t& length, const char* value)
+{
+	uint32_t size = value ? strnlen(value, LOG_STRING_MAX) : 0;
+	if(length + 1 + size <= LOG_RECORD_MAX)
+	{
+		record[length++] = size;
+		logPack(record, length, value, size);
+	}
+}
+
+/**
+ * @brief Packs the arguments behind the ID, the host decoder takes their sizes from the format string
+ */
+template<typename... Args>
+void logBinary(uint16_t id, Args... args)
+{
+	uint8_t record[LOG_RECORD_MAX];
+	uint32_t length = LOG_RECORD_HEADER;
+	(logPack(record, length, args), ...);
+
+	record[0] = LOG_SYNC;
+	record[1] = id & 0xFF;
+	record[2] = id >> 8;
+	record[3] = length - LOG_RECORD_HEADER;
+	logPush(record, length);
+}
+
+#define LOG_STRINGIFY_(x) #x
+#define LOG_STRINGIFY(x) LOG_STRINGIFY_(x)
+
+#if LOG_BINARY
+#define LOG_ENTRY(prefix, format, ...) do { \
+	static const char log_format[] __attribute__((section(".logfmt"), used)) = \
+		prefix "\0" __FILE__ ":" LOG_STRINGIFY(__LINE__) "\0" format; \
+	logBinary((uint16_t)(uintptr_t)log_format, ##__VA_ARGS__); \
+} while(0)
+#else
+#define LOG_ENTRY(prefix, format, ...) log(prefix, __FILE__, __FUNCTION__, __LINE__, format, ##__VA_ARGS__)
+#endif
+
+
+#define LOG_ENABLED(level) (log_levels[LOG_MODULE] >= level)
 
 #if LOG_LEVEL > 2
-#define LOGINFO(format, ...) log("INFO", __FILE__, __FUNCTION__, __LINE__, format, ##__VA_ARGS__)
+#define LOGINFO(format, ...) do { if(LOG_ENABLED(LOG_LEVEL_INFO)) LOG_ENTRY("INFO", format, ##__VA_ARGS__); } while(0)
 #else
 #define LOGINFO(format, ...)
 #endif
 
 #if LOG_LEVEL > 1
-#define LOGTEST(format, ...) log("TEST", __FILE__, __FUNCTION__, __LINE__, format, ##__VA_ARGS__)
-#define PRINTTEST(format, ...) print(format, ##__VA_ARGS__)
+#define LOGTEST(format, ...) do { if(LOG_ENABLED(LOG_LEVEL_TEST)) LOG_ENTRY("TEST", format, ##__VA_ARGS__); } while(0)
+#define PRINTTEST(format, ...) do { if(LOG_ENABLED(LOG_LEVEL_TEST)) print(format, ##__VA_ARGS__); } while(0)
 #else
 #define LOGTEST(format, ...)
 #define PRINTTEST(format, ...)
 #endif
 
 #if LOG_LEVEL > 0
-#define LOGWARN(format, ...) log("WARN", __FILE__, __FUNCTION__, __LINE__, format, ##__VA_ARGS__)
+#define LOGWARN(format, ...) do { if(LOG_ENABLED(LOG_LEVEL_WARN)) LOG_ENTRY("WARN", format, ##__VA_ARGS__); } while(0)
 #else
 #define LOGWARN(format, ...)
 #endif
@@ -3,10 +3,18 @@
 
 #include "spi.h"
 #include "mx25r6435f.h"
+#include "flashjobqueue.h"
+#include "flashjournal.h"
 #include "hyperram.h"
+#include "hyperramarena.h"
 
 #define HYPER_RAM_BASE 0x20000000
 
+/* Measures the flash read throughput at boot, enabled with "make FLASH_BENCHMARK=1" */
+#ifndef FLASH_BENCHMARK
+#define FLASH_BENCHMARK 0
+#endif
+
 class MemoryContext
 {
 private:
@@ -17,7 +25,14 @@ public:
 	void setupMemories();
 	
 	MX25R6435F flash;
+	FlashJobQueue flash_jobs;
+
+	/* Keeps the results in the flash, see FlashJournal */
+	FlashJournal journal;
 	volatile uint8_t *hyperram = (uint8_t*)HYPER_RAM_BASE;
+
+	/* Everything that keeps data in the HyperRAM gets its region from here */
+	HyperRamArena arena;
 };
 
 #endif // MEMORYCONTEXT_H_
\ No newline at end of file
@@ -7,17 +7,62 @@
 #include <math.h>
 
 #define USERSPACE_OFFSET 1200000 //1048576 /* Aligns with a Sector(4KB) */
-#define SECTOR_SIZE 4095
-#define BLOCK32K_SIZE 32767
-#define BLOCK64K_SIZE 65535
+#define SECTOR_SIZE 4096
+#define BLOCK32K_SIZE 32768
+#define BLOCK64K_SIZE 65536
 
 #ifndef MIN(X, Y)
 #define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
 #endif
 
+/**
+ * @brief A single erase command of an ErasePlan
+ */
+struct EraseStep
+{
+	uint32_t address;
+	uint32_t size;
+	uint8_t opcode;
+};
+
+/**
+ * @brief Covers an arbitrary [address, address + len) range with the fewest erase commands,
+ * 64K Blocks where they are aligned and fit, 32K and 4K Sectors towards the edges.
+ * The range gets widened to whole Sectors, so the rest of the edge Sectors is erased too
+ */
+class ErasePlan
+{
+public:
+	ErasePlan();
+	ErasePlan(uint32_t address, uint32_t len);
+
+	/**
+	 * @brief Gives the next erase command of the plan
+	 *
+	 * @retval false if the plan is done
+	 */
+	bool next(EraseStep& step);
+
+	/**
+	 * @brief Amount of erase commands left in the plan
+	 */
+	uint32_t countSteps() const;
+
+	bool done() const { return cursor >= end; }
+
+private:
+	static EraseStep stepAt(uint32_t cursor, uint32_t end);
+
+	uint32_t cursor;
+	uint32_t end;
+};
+
 class MX25R6435F
 {
 public:
+	static constexpr uint32_t PAGE_SIZE = 256;
+	/* 64 Mbit, addresses above wrap around */
+	static constexpr uint32_t FLASH_SIZE = 0x800000;
 
 	MX25R6435F(SPI& spi);
 
@@ -27,11 +72,39 @@ public:
 	uint8_t readByte(uint32_t address);
 
 	/**
-	 * @brief Reads len bytes from the given flash address to dst
+	 * @brief Reads len bytes from the given flash address to dst,
+	 * uses Fast Read and a pipelined SPI burst
 	 */
 	void read(uint32_t address, uint8_t* dst, uint32_t len); 
 	void read(uint32_t address, volatile uint8_t* dst, uint32_t len); 
 
+	/**
+	 * @brief Reads len bytes to dst like read(), while src is written to another SPI device at the same time
+	 */
+	void readWhileWriting(uint32_t address, uint8_t* dst, uint32_t len, SPI& target, const uint8_t* src, uint32_t src_len);
+
+	/**
+	 * @brief Starts a Fast Read that is fetched byte by byte with readNext(), so other work
+	 * can be done while each byte is shifted in. Has to be finished with endRead()
+	 */
+	void beginRead(uint32_t address);
+
+	/**
+	 * @param more false for the last byte that is read
+	 */
+	uint8_t readNext(bool more) { return flash_spi.nextReadBurst(more); }
+	void endRead();
+
+	/**
+	 * @brief Measures the read throughput of the plain Read (byte by byte)
+	 * and of the Fast Read burst and logs both in bytes/second
+	 *
+	 * @param timer a running timer to measure with
+	 * @param address start of the area to be read
+	 * @param len amount of bytes read per measurement, at most MEASURE_SIZE
+	 */
+	void measureReadThroughput(Timer& timer, uint32_t address, uint32_t len);
+
 	/**
 	 * @brief Reads the 24Bit ID of the FLASH, has to be 0xC2 0x28 0x17
 	 */
@@ -67,6 +140,54 @@ public:
 	 */
 	void eraseBlock64K(uint32_t address);
 
+	/**
+	 * @brief erases everything in [address, address + len) with an ErasePlan (blocking operation)
+	 */
+	void eraseRange(uint32_t address, uint32_t len);
+
+	/**
+	 * @brief Starts erasing [address, address + len) in the background,
+	 * pollErase() has to be called until it returns true
+	 */
+	void beginErase(uint32_t address, uint32_t len);
+
+	/**
+	 * @brief Issues the next erase command of the running plan once the flash is idle
+	 *
+	 * @retval true if there is no erase running anymore
+	 */
+	bool pollErase();
+
+	/**
+	 * @brief Blocks till the running erase plan is done
+	 */
+	void finishErase();
+
+	/**
+	 * @brief Suspends a running erase, so the flash can be read in the meantime
+	 *
+	 * @retval true if an erase has been suspended and has to be resumed with resumeErase()
+	 */
+	bool suspendErase();
+
+	/**
+	 * @brief Resumes a suspended erase
+	 */
+	void resumeErase();
+
+	bool isErasing() { return erase_active; }
+
+	/**
+	 * @brief Starts programming len bytes within one page without waiting for it to finish,
+	 * the flash has to be idle (see isBusy())
+	 */
+	void startPageProgram(uint32_t address, const uint8_t* data, uint32_t len);
+
+	/**
+	 * @brief Checks if a program or erase command is still executed by the flash
+	 */
+	bool isBusy();
+
 	/**
 	 * @brief Tests the Funcion of the Flash 
 	 * 
@@ -79,36 +200,61 @@ private:
 	void writeEnable();
 	void writeDisable();
 	void writeAddress(uint32_t address);
+
+	/**
+	 * @brief Starts a Fast Read at the given address, CS stays asserted
+	 */
+	void startFastRead(uint32_t address);
 	uint8_t readStatus();
+	uint8_t readSecurity();
 	bool writeInProgress();
 
+	void startErase(const EraseStep& step);
+
 	/**
 	 * @brief writes into the flash naively without considering page boundaries
 	 */
 	void naiveWrite(uint32_t address, const uint8_t *data, uint32_t len);
 
+	friend class ErasePlan;
+
 	SPI flash_spi;
 
+	ErasePlan erase_plan;
+	bool erase_active = false;
+	bool erase_suspended = false;
+
+	/* An erase has been suspended for the read between beginRead() and endRead() */
+	bool read_suspended = false;
+
+	/* A program or erase has been started outside of an erase plan and may still be running */
+	bool command_pending = false;
+
 	static constexpr uint32_t TEST_SIZE 				= 10;
 	static constexpr uint32_t TESTSPACE_OFFSET 			= USERSPACE_OFFSET - SECTOR_SIZE;
 	static constexpr uint8_t  TEST_ARRAY[TEST_SIZE] 	= {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+	static constexpr uint32_t MEASURE_SIZE 				= 1024;
 	
 	static constexpr uint8_t WRITE_IN_PROGRESS_BIT = 1 << 0;
+	static constexpr uint8_t ERASE_SUSPENDED_BIT = 1 << 3;
 
 	static constexpr uint8_t NOP 				= 0x00;
 	static constexpr uint8_t READ 				= 0x03;
+	static constexpr uint8_t FAST_READ 			= 0x0B; /* Needs 8 Dummy Cycles after the Address */
 	static constexpr uint8_t READ_STATUS		= 0x05;
+	static constexpr uint8_t READ_SECURITY		= 0x2B;
 	static constexpr uint8_t READ_ID 			= 0x9F;
 	static constexpr uint8_t RESET_ENABLE		= 0x66; /* Reset Enable must be executed before executing the RST Command*/
 	static constexpr uint8_t RESET 				= 0x99;
 
 	static constexpr uint8_t SECTOR_ERASE 		= 0x20;
 	static constexpr uint8_t BLOCK_ERASE_32K 	= 0x52;
-	static constexpr uint8_t BLOCK_ERASE_64K 	= 0x03;
+	static constexpr uint8_t BLOCK_ERASE_64K 	= 0xD8;
+	static constexpr uint8_t ERASE_SUSPEND 		= 0xB0;
+	static constexpr uint8_t ERASE_RESUME 		= 0x30;
 	static constexpr uint8_t WRITE_ENABLE 		= 0x06; /* Write Enable must be executed before any Write/Erase Operation*/
 	static constexpr uint8_t WRITE_DISABLE		= 0x04;
 	static constexpr uint8_t WRITE				= 0x02;
-	static constexpr uint32_t PAGE_SIZE 		= 256;
 };
 
 
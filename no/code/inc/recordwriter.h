@@ -0,0 +1,63 @@
+#ifndef RECORDWRITER_H_
+#define RECORDWRITER_H_
+
+#include "stdint.h"
+#include "resultrecord.h"
+#include "hyperramwriter.h"
+#include "crc16.h"
+#include "logging.h"
+
+/**
+ * @brief Writes records in the format of resultrecord.h into a HyperRamRegion.
+ * The header is written by begin(), the payload is streamed in between and end() appends the CRC,
+ * so no record has to be buffered in the SRAM.
+ * A record always gets the length of its schema, missing payload is padded with zeroes
+ * and surplus payload is dropped, so a reader never loses the record boundaries
+ */
+class RecordWriter
+{
+public:
+	RecordWriter(HyperRamRegion* region) : writer(region) {}
+
+	/**
+	 * @brief Starts a record, a record that is still open is ended first
+	 *
+	 * @param timestamp running time of the experiment in timer ticks
+	 * @retval false if the type has no schema, nothing is written till the next begin() then
+	 */
+	bool begin(RecordType type, uint32_t timestamp);
+
+	void put8(uint8_t value);
+	void put16(uint16_t value);
+	void put32(uint32_t value);
+	void putFloat(float value);
+	void putBytes(const uint8_t* src, uint32_t len);
+
+	/**
+	 * @brief Completes the payload if necessary and appends the CRC
+	 */
+	void end();
+
+	/**
+	 * @brief See HyperRamWriter::flush()
+	 */
+	void flush() { writer.flush(); }
+
+	/**
+	 * @brief Clears the region and drops an open record
+	 */
+	void reset();
+
+	uint32_t getUsed() { return writer.getUsed(); }
+
+private:
+	void add(uint8_t byte);
+
+	HyperRamWriter writer;
+
+	const RecordSchema* schema = nullptr;
+	uint16_t written = 0;
+	uint16_t crc = CRC16_INIT;
+};
+
+#endif // RECORDWRITER_H_
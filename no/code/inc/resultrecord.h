@@ -0,0 +1,169 @@
+#ifndef RESULTRECORD_H_
+#define RESULTRECORD_H_
+
+#include "stdint.h"
+
+/*
+ * Record format of the experiment results in the HyperRAM, shared by the firmware (RecordWriter)
+ * and the host tools (sip-decoder), so it must not depend on anything but stdint.
+ * All values are stored MSB first.
+ *
+ * Record:	type (uint8), schema version (uint8), payload length (uint16), timestamp (uint32),
+ *			payload as described by the schema of the type,
+ *			CRC16 CCITT (init 0xFFFF) over header and payload (uint16)
+ *
+ * The timestamp is the running time of the experiment in timer ticks (8 MHz).
+ * A type of 0x00 or 0xFF marks the end of the recorded data.
+ * Bytes of RECORD_PAD stand for lost data (e.g. the start of a region that has been dropped
+ * from the flash journal) and are skipped, the next record may be cut off by the gap.
+ */
+
+#define RECORD_SCHEMA_VERSION 1
+#define RECORD_HEADER_SIZE 8
+#define RECORD_CRC_SIZE 2
+
+enum RecordType : uint8_t
+{
+	RECORD_EXPERIMENT_START = 1,
+	RECORD_EXPERIMENT_END = 2,
+	RECORD_SENSORS = 3,
+	RECORD_UVVMIN_TEST = 4,
+	RECORD_ISFD_TEST = 5,
+	RECORD_RISCV_MATRIX = 6,
+	RECORD_FLASH_SCAN = 7,
+
+	RECORD_PAD = 0xFE,		/* Single padding byte, has no header */
+};
+
+/* The lower nibble is the size of one element */
+enum RecordFieldType : uint8_t
+{
+	FIELD_U8 = 0x01,
+	FIELD_U16 = 0x02,
+	FIELD_U32 = 0x04,
+	FIELD_FLOAT = 0x14,		/* IEEE 754 bit pattern */
+};
+
+struct RecordField
+{
+	const char* name;
+	RecordFieldType type;
+	uint8_t count;			/* Array of count elements */
+};
+
+struct RecordSchema
+{
+	RecordType type;
+	const char* name;
+	const RecordField* fields;
+	uint8_t field_count;
+	uint16_t length;		/* Payload length, follows from the fields */
+};
+
+constexpr uint16_t fieldSize(const RecordField& field)
+{
+	return (field.type & 0x0F) * field.count;
+}
+
+template<uint8_t N>
+constexpr uint16_t payloadLength(const RecordField (&fields)[N])
+{
+	uint16_t length = 0;
+	for(uint8_t i = 0; i < N; i++)
+	{
+		length += fieldSize(fields[i]);
+	}
+	return length;
+}
+
+constexpr RecordField EXPERIMENT_START_FIELDS[] =
+{
+	{"experiment_id", FIELD_U8, 1},
+};
+
+constexpr RecordField EXPERIMENT_END_FIELDS[] =
+{
+	{"recorded_bytes", FIELD_U32, 1},
+};
+
+constexpr RecordField SENSORS_FIELDS[] =
+{
+	{"voltage_ch1_raw", FIELD_U16, 1},
+	{"voltage_ch2_raw", FIELD_U16, 1},
+	{"current_ch1_raw", FIELD_U16, 1},
+	{"current_ch2_raw", FIELD_U16, 1},
+	{"power_ch1", FIELD_U32, 1},
+	{"power_ch2", FIELD_U32, 1},
+	{"acc_current_ch1", FIELD_U32, 1},
+	{"acc_current_ch2", FIELD_U32, 1},
+	{"temp1_raw", FIELD_U16, 1},
+	{"temp2_raw", FIELD_U16, 1},
+	{"temp3_raw", FIELD_U16, 1},
+};
+
+constexpr RecordField UVVMIN_TEST_FIELDS[] =
+{
+	{"voltage", FIELD_U16, 1},
+	{"counter", FIELD_U32, 1},
+};
+
+constexpr RecordField ISFD_TEST_FIELDS[] =
+{
+	{"test_case", FIELD_U16, 1},
+	{"result", FIELD_U16, 1},
+	{"flags", FIELD_U8, 1},
+};
+
+/* Array sizes are MATRIX_SIZE, SENSORREADINGS_SIZE and ERROR_SIZE of the RiscvMatrixExperiment */
+constexpr RecordField RISCV_MATRIX_FIELDS[] =
+{
+	{"test_id", FIELD_U8, 1},
+	{"horizontal_sum", FIELD_U32, 32},
+	{"vertical_sum", FIELD_U32, 32},
+	{"pre_test_readings", FIELD_FLOAT, 10},
+	{"after_test_readings", FIELD_FLOAT, 10},
+	{"errors", FIELD_U8, 5},
+};
+
+/* The flip counts are totals of the classifier over all passes so far */
+constexpr RecordField FLASH_SCAN_FIELDS[] =
+{
+	{"pass", FIELD_U32, 1},
+	{"mismatches", FIELD_U32, 1},
+	{"seu", FIELD_U32, 1},
+	{"sticky", FIELD_U32, 1},
+	{"cluster", FIELD_U32, 1},
+	{"dropped", FIELD_U32, 1},
+};
+
+#define RECORD_SCHEMA(type, fields) {type, #type, fields, sizeof(fields) / sizeof(fields[0]), payloadLength(fields)}
+
+constexpr RecordSchema RECORD_SCHEMAS[] =
+{
+	RECORD_SCHEMA(RECORD_EXPERIMENT_START, EXPERIMENT_START_FIELDS),
+	RECORD_SCHEMA(RECORD_EXPERIMENT_END, EXPERIMENT_END_FIELDS),
+	RECORD_SCHEMA(RECORD_SENSORS, SENSORS_FIELDS),
+	RECORD_SCHEMA(RECORD_UVVMIN_TEST, UVVMIN_TEST_FIELDS),
+	RECORD_SCHEMA(RECORD_ISFD_TEST, ISFD_TEST_FIELDS),
+	RECORD_SCHEMA(RECORD_RISCV_MATRIX, RISCV_MATRIX_FIELDS),
+	RECORD_SCHEMA(RECORD_FLASH_SCAN, FLASH_SCAN_FIELDS),
+};
+
+#define RECORD_SCHEMA_COUNT (sizeof(RECORD_SCHEMAS) / sizeof(RECORD_SCHEMAS[0]))
+
+/**
+ * @retval schema of the record type or nullptr if the type is unknown
+ */
+constexpr const RecordSchema* findSchema(uint8_t type)
+{
+	for(uint32_t i = 0; i < RECORD_SCHEMA_COUNT; i++)
+	{
+		if(RECORD_SCHEMAS[i].type == type)
+		{
+			return &RECORD_SCHEMAS[i];
+		}
+	}
+	return nullptr;
+}
+
+#endif // RESULTRECORD_H_
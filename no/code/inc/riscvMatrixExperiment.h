@@ -52,6 +52,7 @@ static const uint16_t matrixVoltageSteps[] = {1200,950,945,940,935,930,925,920,9
 #define BUFFER_SIZE         6  				                                // 3 for DUT, 6 for the Testbench
 #define UART_TIMEOUT_LIMIT5 5
 #define UART_TIMEOUT_LIMIT7 7
+#define UART_BYTE_TIMEOUT   (10 * MILLISECOND)                              // max gap between two bytes of a frame
 
 // ----- UART FLAG DEFINITIONS ---------------------------------------------------------------------------------------------------------------------------------
 
@@ -103,7 +104,7 @@ class RiscvMatrixExperiment: public Experiment
 {
 public:
     RiscvMatrixExperiment(SensorContext& sensorcontext, ICE40PROG& programmer, MemoryContext& memorycontext, Serial& iceUART) : 
-	Experiment(sensorcontext, programmer, memorycontext, iceUART), timer1(TimerID::TIMER1)
+	Experiment(sensorcontext, programmer, memorycontext, iceUART, "riscvmatrix"), timer1(TimerID::TIMER1)
     {
        
     }
@@ -144,7 +145,6 @@ private:
     uint8_t incoming_data[4];
 
     uint32_t timeoutTime;
-    uint16_t ram_counter;                    //stores current ram writepoint
     uint8_t errorCounter[ERROR_SIZE];       //stores errors and restarts
 
 	uint8_t currentTestID;
@@ -186,6 +186,11 @@ private:
 	 */
     void writeDataRAM();
 
+    /**
+	 * @brief Time since the timer was started, like in the other experiments
+	 */
+    uint32_t runningTime();
+
     /**
 	 * @brief Calculates and Sets the Voltage in relation to the TestID
 	 */
@@ -212,10 +217,10 @@ private:
     bool checkCRC8(uint8_t* data, uint8_t length);
 
     /**
-	 * @brief Checks the current UART Buffer
-     * @retval returns 0 (success) or -1 (fail)
+	 * @brief Checks the current UART Buffer, shifts in up to max_retries further bytes till the CRC matches
+     * @retval returns 0 (success) or -1 (fail or no byte within UART_BYTE_TIMEOUT)
 	 */
-    uint8_t validateBuffer(uint8_t *buffer, uint8_t length, uint8_t max_retries);
+    int8_t validateBuffer(uint8_t *buffer, uint8_t length, uint8_t max_retries);
 
     /**
 	 * @brief Separates a 32-bit data into 4 bytes
@@ -0,0 +1,89 @@
+#ifndef SCANPATTERN_H_
+#define SCANPATTERN_H_
+
+#include <stdint.h>
+
+/* Kept free of any Hardware includes, so the compare kernel can also be
+   built and benchmarked on the host against a file backed flash image */
+
+struct ScanMismatch
+{
+	uint32_t address;		/* Flash address of the mismatching byte */
+	uint32_t pass;			/* Scan pass the mismatch was found in */
+	uint8_t expected;		/* Byte of the reference pattern */
+	uint8_t actual;			/* Byte that has been read from the flash */
+	uint8_t flipped;		/* Bitmask of the flipped bits (expected ^ actual) */
+};
+
+/**
+ * @brief Receives every mismatching byte a scan finds
+ */
+class ScanMismatchSink
+{
+public:
+	virtual ~ScanMismatchSink() {}
+	virtual void onMismatch(const ScanMismatch& mismatch) = 0;
+};
+
+class ScanPattern
+{
+public:
+	/**
+	 * @brief Generates the reference word for a 4 Byte aligned flash address,
+	 * xorshift only, since the CPU (rv32i) has no hardware multiplier
+	 *
+	 * The byte at address A is byte (A & 3) of word(A & ~3), little endian
+	 */
+	static inline uint32_t word(uint32_t address, uint32_t seed)
+	{
+		uint32_t x = (address >> 2) ^ seed;
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		return x;
+	}
+
+	/**
+	 * @brief Fills dst with the reference pattern starting at the given (aligned) address
+	 */
+	static void fill(uint32_t* dst, uint32_t address, uint32_t words, uint32_t seed);
+
+	/**
+	 * @brief Compares a chunk of flash data against the reference pattern word by word,
+	 * only a mismatching word is broken down into bytes and bits
+	 *
+	 * @param data chunk read from the flash
+	 * @param address flash address of data[0], has to be 4 Byte aligned
+	 * @param words amount of words in data
+	 * @param seed seed of the reference pattern
+	 * @param pass current scan pass, handed to the sink
+	 * @param sink gets every mismatching byte, may be nullptr
+	 *
+	 * @retval amount of mismatching bytes in the chunk
+	 */
+	static uint32_t compare(const uint32_t* data, uint32_t address, uint32_t words, uint32_t seed, uint32_t pass, ScanMismatchSink* sink);
+
+	/**
+	 * @brief Same as compare() for a single word, the matching word is handled inline
+	 *
+	 * @retval amount of mismatching bytes in the word
+	 */
+	static inline uint32_t compareWord(uint32_t data, uint32_t address, uint32_t seed, uint32_t pass, ScanMismatchSink* sink)
+	{
+		uint32_t expected = word(address, seed);
+		if(data == expected)
+		{
+			return 0;
+		}
+
+		return reportWord(data, expected, address, pass, sink);
+	}
+
+private:
+	/**
+	 * @brief Breaks a mismatching word down into its bytes and hands them to the sink
+	 */
+	static uint32_t reportWord(uint32_t data, uint32_t expected, uint32_t address, uint32_t pass, ScanMismatchSink* sink);
+};
+
+#endif // SCANPATTERN_H_
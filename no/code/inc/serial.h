@@ -7,6 +7,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <irq.h>
+#include "timer.h"
 
 enum UARTDevice
 {
@@ -16,16 +17,15 @@ enum UARTDevice
 	UART_DEVICE_COUNT,
 };
 
+/**
+ * @brief UART Interface, instances are created through BufferedSerial which holds the RX buffer
+ */
 class Serial
 {
 public:
 	/**
-	 * @brief Creates and Initializes the UART Interface
-	 */
-	Serial(UARTDevice device);
-
-	/**
-	 * @brief Enables the Interrupt Service routine during rx events
+	 * @brief Enables the Interrupt Service routine during rx events and the interrupt driven transmission,
+	 * gateware without a TX event keeps sending polled
 	 */
 	void initInterrupts();
 
@@ -35,20 +35,40 @@ public:
 	void resetInterrupt();
 
 	/**
-	 * @brief Writes a single byte into the UART Interface, (blocking operation)
+	 * @brief Writes a single byte into the UART Interface, only blocks while the TX buffer is full
+	 * once initInterrupts() has been called
 	 * 
 	 * @param byte the byte thats to be written
 	 */
 	void write(uint8_t byte);
 
 	/**
-	 * @brief Writes a multiple bytes into the UART Interface, (blocking operation)
+	 * @brief Writes a multiple bytes into the UART Interface, only blocks while the TX buffer is full
+	 * once initInterrupts() has been called
 	 * 
 	 * @param bytes the bytes that have to be written
 	 * @param length the length of the given array
 	 */
 	void write(uint8_t* bytes, uint32_t length);
 
+	/**
+	 * @brief Queues as many bytes as fit into the TX buffer, they are sent from the TX ready interrupt (non-blocking).
+	 * Without initInterrupts() or without a TX event all bytes are written blocking
+	 * 
+	 * @retval amount of bytes taken, the rest has to be written again later
+	 */
+	uint32_t writeAsync(const uint8_t* bytes, uint32_t length);
+
+	/**
+	 * @brief Tells you how many bytes fit into the TX buffer
+	 */
+	uint32_t txFree();
+
+	/**
+	 * @brief Waits till the TX buffer is empty and the last byte has left the UART (blocking operation)
+	 */
+	void flush();
+
 	/**
 	 * @brief Reads a single byte from the UART Interface, (blocking operation)
 	 * 
@@ -57,12 +77,30 @@ public:
 	uint8_t read();
 
 	/**
-	 * @brief Reads a single byte from the UART Interface, (non-blocking)
+	 * @brief Reads a single byte from the UART Interface, waits at most 100ms for it
 	 * 
-	 * @retval the byte received from the UART
+	 * @retval the byte received from the UART, 0 after the timeout
 	 */
 	uint8_t readNonBlocking();
 
+	/**
+	 * @brief Reads a single byte from the UART Interface, waits till the deadline measured with the Timer
+	 * from useTimer() passed. Without a Timer only an already received byte is returned
+	 * 
+	 * @param byte is only written if a byte was received
+	 * @param timeoutTicks how long to wait in clock ticks, 0 returns right away
+	 * @retval true if a byte was received, false after the timeout
+	 */
+	bool read(uint8_t& byte, uint32_t timeoutTicks);
+
+	/**
+	 * @brief Copies all received bytes into dst at once (non-blocking)
+	 * 
+	 * @param max size of dst, the remaining bytes stay in the buffer
+	 * @retval amount of bytes copied
+	 */
+	size_t readAvailable(uint8_t* dst, size_t max);
+
 	/**
 	 * @brief Tells you how many bytes are pending in the Buffer
 	 * 
@@ -89,18 +127,56 @@ public:
 
 	void printStatus();
 
+	/**
+	 * @brief Tells you how many received bytes were dropped because the RX buffer was full
+	 */
+	uint32_t getDroppedBytes() { return rx_dropped; }
+
+	/**
+	 * @brief Tells you how often the RX buffer ran full, a burst of dropped bytes counts once
+	 */
+	uint32_t getOverruns() { return rx_overruns; }
+
+	/**
+	 * @brief Sets the Timer all reads with a timeout measure their deadline with
+	 */
+	static void useTimer(Timer* timer);
+
 	/**
 	 * @brief Keeps all instances that use interrupts
 	 */
 	static Serial* interrupt_instances[CONFIG_CPU_INTERRUPTS];
 	static uint32_t instance_mask;
 
+protected:
+	/**
+	 * @brief Creates and Initializes the UART Interface
+	 * 
+	 * @param rx_buffer storage for the received bytes
+	 * @param rx_size size of rx_buffer, must be power of two
+	 */
+	Serial(UARTDevice device, uint8_t* rx_buffer, uint32_t rx_size);
+
 private:
 	/**
-	 * @brief Interrupt service routine for the UART Receive signal
+	 * @brief Interrupt service routine for the UART Receive and Transmit Ready signals
 	 */
 	static void uartIsr();
 
+	static Timer* deadline_timer;
+
+	/**
+	 * @brief Hands the next byte of the TX buffer to the UART if it is ready
+	 */
+	void serviceTX();
+
+	/**
+	 * @brief Starts sending the TX buffer if the UART is idle, the interrupt sends the rest
+	 */
+	void kickTX();
+
+	bool txReady();
+
 	uint32_t uart_base_addr;
 	uint32_t uart_interrupt;
 
@@ -120,13 +196,42 @@ private:
 	static constexpr uint32_t FE_OFFSET 		= 2;
 	static constexpr uint32_t PE_OFFSET 		= 3;
 	static constexpr uint32_t EV_RX 			= 0;
+	static constexpr uint32_t EV_TX 			= 1;
+
+	static constexpr uint32_t READ_TIMEOUT 		= 100 * MILLISECOND;
+
+	/* write_head is only moved by the ISR, read_head only by read*() */
+	uint8_t* rx_buffer;
+	uint32_t rx_mask;
+	volatile uint32_t write_head = 0;
+	volatile uint32_t read_head = 0;
+	volatile uint32_t rx_dropped = 0;
+	volatile uint32_t rx_overruns = 0;
+	bool rx_full = false;
 
 	/* Must be power of two */
-	static constexpr uint32_t UART_BUF_SIZE = 1 << 8; 
+	static constexpr uint32_t TX_BUF_SIZE = 1 << 9;
 
-	uint8_t uart_buffer[UART_BUF_SIZE] = {0};
-	uint8_t write_head = 0;
-	uint8_t read_head = 0;
+	/* tx_head is only moved by write*(), tx_tail only by serviceTX() */
+	uint8_t tx_buffer[TX_BUF_SIZE] = {0};
+	volatile uint16_t tx_head = 0;
+	volatile uint16_t tx_tail = 0;
+	bool tx_interrupts = false;
+};
+
+/**
+ * @brief Serial with its own RX buffer of RX_BUF_SIZE bytes, one byte less can be pending
+ */
+template<uint32_t RX_BUF_SIZE>
+class BufferedSerial : public Serial
+{
+	static_assert(RX_BUF_SIZE && !(RX_BUF_SIZE & (RX_BUF_SIZE - 1)), "RX_BUF_SIZE must be power of two");
+
+public:
+	BufferedSerial(UARTDevice device) : Serial(device, rx_storage, RX_BUF_SIZE) {}
+
+private:
+	uint8_t rx_storage[RX_BUF_SIZE] = {0};
 };
 
 #endif /* _SERIAL_H_ */
@@ -9,7 +9,7 @@ static constexpr uint8_t BOUNDARY_REPLACE = 0x5E;
 static constexpr uint8_t ESCAPE_REPLACE = 0x5D;
 
 static constexpr uint8_t FIRST_DELIMITER_OFFSET = 0;
-static constexpr uint8_t LAST_DELIMITER_OFFSET(uint16_t DATA_LENGTH) { return (7 + DATA_LENGTH); }
+static constexpr uint16_t LAST_DELIMITER_OFFSET(uint16_t DATA_LENGTH) { return (7 + DATA_LENGTH); }
 
 static constexpr uint8_t COBS_START_OFFSET = 0;
 static constexpr uint8_t LENGTH_L_OFFSET = 2;
@@ -18,9 +18,9 @@ static constexpr uint8_t SEQUENCE_OFFSET = 3;
 static constexpr uint8_t PAYLOAD_ADDRESS_OFFSET = 4;
 static constexpr uint8_t FUNCTION_CODE_OFFSET = 5;
 static constexpr uint8_t DATA_OFFSET = 6;
-static constexpr uint8_t CRC_OFFSET_L(uint16_t DATA_LENGTH) { return (7 + DATA_LENGTH); }
-static constexpr uint8_t CRC_OFFSET_H(uint16_t DATA_LENGTH) { return (6 + DATA_LENGTH); }
-static constexpr uint8_t COBS_END_OFFSET(uint16_t DATA_LENGTH) { return (8 + DATA_LENGTH); }
+static constexpr uint16_t CRC_OFFSET_L(uint16_t DATA_LENGTH) { return (7 + DATA_LENGTH); }
+static constexpr uint16_t CRC_OFFSET_H(uint16_t DATA_LENGTH) { return (6 + DATA_LENGTH); }
+static constexpr uint16_t COBS_END_OFFSET(uint16_t DATA_LENGTH) { return (8 + DATA_LENGTH); }
 static constexpr uint8_t LENGTH_WITHOUT_DATA = 5;
 
 enum PowerState
@@ -78,48 +78,38 @@ public:
 	 * @brief Decodes an array in the HDLC format, meaning seeing
 	 * 0x7E as frame boundaries and 0x7D as escape characters
 	 * 
-	 * Since this changes the given array, make sure to have some extra space left
-	 * in the array for the extra bytes to fit
+	 * Works in place in a single pass, the read index runs ahead of the write index,
+	 * an escape character at the very end is dropped
 	 * 
 	 * @retval amount of bytes the array length decreased
 	 */
 	static uint32_t hdlc_decode(uint8_t* data, uint16_t len)
 	{
-		uint8_t copy[len];
-
-		for(uint32_t i = 0; i < len; i++)
-		{
-			copy[i] = data[i];
-		}
-
-		/* Index offset is needed incase the escape character happens
-			we skip one byte in the buffer */
-		uint32_t index_offset = 0;
-		for(uint16_t i = 0; i < len; i++)
+		uint16_t write = 0;
+		for(uint16_t read = 0; read < len; read++)
 		{
-			uint8_t cur_byte = copy[i + index_offset];
-			uint8_t next_byte = copy[i + index_offset + 1];
+			uint8_t cur_byte = data[read];
 			if(cur_byte == ESCAPE)
 			{
-				switch(next_byte)
+				if(++read >= len)
 				{
-					case BOUNDARY_REPLACE:
-						data[i] = BOUNDARY;
-					break;
-
-					case ESCAPE_REPLACE:
-						data[i] = ESCAPE;
 					break;
 				}
-				index_offset++;
-			}
-			else
-			{
-				data[i] = cur_byte;
+				/* BOUNDARY_REPLACE and ESCAPE_REPLACE are the escaped bytes with bit 5 flipped */
+				cur_byte = data[read] ^ 0x20;
 			}
+			data[write++] = cur_byte;
 		}
 
-		return index_offset;
+		return len - write;
+	}
+
+	/**
+	 * @brief Tells you if a byte has to be escaped in the HDLC format
+	 */
+	static bool hdlc_needs_escape(uint8_t byte)
+	{
+		return byte == BOUNDARY || byte == ESCAPE;
 	}
 
 	/**
@@ -127,48 +117,36 @@ public:
 	 * 0x7E as frame boundaries and 0x7D as escape characters
 	 * 
 	 * Since this changes the given array, make sure to have some extra space left
-	 * in the array for the extra bytes to fit
+	 * in the array for the extra bytes to fit. Works in place, the escapes are counted first
+	 * and the array is then filled from the back. To send a frame, SIPHandler encodes it
+	 * on the way to the UART instead
 	 * 
 	 * @retval amount of bytes the array length increased
 	 */
 	static uint32_t hdlc_encode(uint8_t* data, uint16_t len)
 	{
-		uint8_t copy[len];
-
-		for(uint32_t i = 0; i < len; i++)
+		uint32_t increase = 0;
+		for(uint16_t i = 0; i < len; i++)
 		{
-			copy[i] = data[i];
+			increase += hdlc_needs_escape(data[i]);
 		}
 
-		/* Index offset is needed incase the escape character happens
-			we skip one byte in the buffer */
-		uint32_t index_offset = 0;
-		for(uint32_t i = 0; i < len; i++)
+		uint32_t write = len + increase;
+		for(uint16_t read = len; read > 0; read--)
 		{
-			uint8_t cur_byte = copy[i];
-			
-			if(cur_byte == ESCAPE || cur_byte == BOUNDARY)
+			uint8_t cur_byte = data[read - 1];
+			if(hdlc_needs_escape(cur_byte))
 			{
-				data[i + index_offset] = ESCAPE;
-				switch(cur_byte)
-				{
-					case ESCAPE:
-						data[i + index_offset + 1] = ESCAPE_REPLACE;
-					break;
-
-					case BOUNDARY:
-						data[i + index_offset + 1] = BOUNDARY_REPLACE;
-					break;
-				}
-				index_offset++;
+				data[--write] = cur_byte ^ 0x20;
+				data[--write] = ESCAPE;
 			}
 			else
 			{
-				data[i + index_offset] = cur_byte;
+				data[--write] = cur_byte;
 			}
 		}
 
-		return index_offset;
+		return increase;
 	}
 };
 
@@ -5,51 +5,88 @@
 #include "sip.h"
 #include "sipcommand.h"
 #include "sipresponse.h"
+#include "sipresponsesink.h"
 
-#define SIP_HANDLER_BUF_SIZE 512
-#define ACK 1
-#define NACK 0
-
-#define POWERED_ON 1
-#define POWERED_OFF 0
-
-enum Command
-{
-	NOTHING = -1,
-	RISA_INIT_COMMAND_ID = 0,
-	SHUTDOWN_COMMAND_ID = 1,
-	TEST_START_COMMAND_ID = 2,
-	TEST_STATUS_COMMAND_ID = 0x0C,
-	TESTDATA_COMMAND_ID = 3,
-	HOUSEKEEPINGDATA_COMMAND_ID = 4,
-	MEMORY_WRITE_INIT_COMMAND_ID = 5,
-	MEMORY_WRITE_DATA_COMMAND_ID = 6,
-	MEMORY_DUMP_COMMAND_ID = 7,
-};
-
-enum Response
-{
-	ACK_NACK_RESPONSE_ID = 8,
-	TESTDATA_RESPONSE_ID = 0x0E,
-	TEST_STATUS_RESPONSE_ID = 0x0D,
-	HOUSEKEEPINGDATA_RESPONSE_ID = 10,
-	MEMORY_DUMP_RESPONSE_ID = 11,
-};
-
-class SIPHandler
+/**
+ * @brief Receives the commands from the OBC and streams the responses to it over the UART
+ */
+class SIPHandler : public SipResponseSink
 {
 public:
 	SIPHandler(Serial& obc);
 
+	/**
+	 * @brief Parses the received bytes into command (non-blocking), a partial frame is continued with the next call
+	 *
+	 * @retval true once a complete frame with a valid CRC is in command
+	 */
 	bool run(SIPCommand* command);
-	void sendResponse(SIPReponse response);
-	void sendAck(uint8_t sequence);
-	void sendNack(uint8_t sequence);
+	void sendResponse(const SIPReponse& response);
+
+	/**
+	 * @brief Starts a response frame that is streamed to the UART, the CRC is calculated and the bytes are escaped on the way
+	 *
+	 * @param data_len amount of data that follows through writeResponseData() before endResponse()
+	 */
+	void beginResponse(uint8_t sequence, uint8_t power_state, uint8_t response_type, uint16_t data_len) override;
+
+	/**
+	 * @brief Appends data to the started response, can be called as often as needed, e.g. straight out of the HyperRAM
+	 */
+	void writeResponseData(const uint8_t* data, uint32_t len) override;
+
+	/**
+	 * @brief Sends the CRC and closes the frame, missing data is padded with zeros so the frame stays valid
+	 */
+	void endResponse() override;
+
+	void sendAck(uint8_t sequence) override;
+	void sendNack(uint8_t sequence) override;
+
+	/**
+	 * @brief Sends an ACK or NACK with additional data behind the ACK/NACK byte
+	 *
+	 * @param len at most ACK_DATA_SIZE, the rest is cut off
+	 */
+	void sendAckNack(uint8_t sequence, uint8_t ack, const uint8_t* data, uint16_t len) override;
 private:
 
+	enum ParseState
+	{
+		WAIT_BOUNDARY,
+		FRAME_DATA,
+		FRAME_DISCARD,
+	};
+
+	/**
+	 * @brief Feeds one received byte into the frame, HDLC decoded and added to the CRC on the fly
+	 *
+	 * @retval true if the byte completed a valid frame
+	 */
+	bool parse(SIPCommand* command, uint8_t byte);
+
+	bool finishFrame(SIPCommand* command);
+
+	/**
+	 * @brief Writes bytes HDLC encoded straight to the UART, runs without BOUNDARY or ESCAPE are written in one piece
+	 */
+	void writeEscaped(const uint8_t* bytes, uint32_t length);
+
 	Serial& obc;
-	uint8_t buffer[SIP_HANDLER_BUF_SIZE];
-	uint32_t buffer_index = 0;
+	uint32_t reported_overruns = 0;
+
+	/* Frame that is currently received, frame_length is only known after the length field */
+	ParseState state = WAIT_BOUNDARY;
+	uint16_t frame_index = 0;
+	uint16_t frame_length = 0;
+	uint16_t frame_crc = CRC16_INIT;
+	bool escaped = false;
+
+	/* Response that is currently streamed */
+	uint16_t response_crc = CRC16_INIT;
+	uint32_t response_remaining = 0;
+	/* Data that didnt fit into the response, only logged once it is complete */
+	uint32_t response_cut_off = 0;
 };
 
 
@@ -0,0 +1,67 @@
+#ifndef SIPCOMMANDROUTER_H_
+#define SIPCOMMANDROUTER_H_
+
+#include "sipcommand.h"
+#include "sipresponsesink.h"
+
+enum Command
+{
+	NOTHING = -1,
+	RISA_INIT_COMMAND_ID = 0,
+	SHUTDOWN_COMMAND_ID = 1,
+	TEST_START_COMMAND_ID = 2,
+	TEST_STATUS_COMMAND_ID = 0x0C,
+	TESTDATA_COMMAND_ID = 3,
+	HOUSEKEEPINGDATA_COMMAND_ID = 4,
+	MEMORY_WRITE_INIT_COMMAND_ID = 5,
+	MEMORY_WRITE_DATA_COMMAND_ID = 6,
+	MEMORY_DUMP_COMMAND_ID = 7,
+	LOG_LEVEL_COMMAND_ID = 0x10,
+	BULK_READ_COMMAND_ID = 0x11,
+	BULK_CONTINUE_COMMAND_ID = 0x12,
+	SLOT_REGISTER_COMMAND_ID = 0x13,
+};
+
+/* Function codes at or above this have no handler and are always NACKed */
+#define SIP_ROUTER_TABLE_SIZE 32
+
+/**
+ * @brief Handles one or more SIP function codes, keeps all the state it needs between commands
+ */
+class SipCommandHandler
+{
+public:
+	virtual ~SipCommandHandler() {}
+
+	/**
+	 * @brief Answers the command, responses are streamed through the SipResponseSink
+	 */
+	virtual void handle(SIPCommand& command) = 0;
+};
+
+/**
+ * @brief Dispatches received commands to the handler registered for their function code
+ */
+class SipCommandRouter
+{
+public:
+	SipCommandRouter(SipResponseSink& sip);
+
+	/**
+	 * @brief Registers handler for function_code, one handler can be registered for multiple codes
+	 *
+	 * @retval false if the code is out of the table or already taken
+	 */
+	bool add(uint8_t function_code, SipCommandHandler* handler);
+
+	/**
+	 * @brief Calls the handler of the command, commands without one get a NACK
+	 */
+	void dispatch(SIPCommand& command);
+
+private:
+	SipResponseSink& sip;
+	SipCommandHandler* handlers[SIP_ROUTER_TABLE_SIZE] = {nullptr};
+};
+
+#endif // SIPCOMMANDROUTER_H_
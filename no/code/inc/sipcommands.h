@@ -0,0 +1,216 @@
+#ifndef SIPCOMMANDS_H_
+#define SIPCOMMANDS_H_
+
+#include "experimentmanager.h"
+#include "memorycontext.h"
+#include "ice40prog.h"
+#include "serial.h"
+#include "sipcommandrouter.h"
+
+/**
+ * @brief RISA_INIT, the OBC asks if we are ready, we say ACK everytime currently
+ */
+class RisaInitHandler : public SipCommandHandler
+{
+public:
+	RisaInitHandler(SipResponseSink& sip) : sip(sip) {}
+	void handle(SIPCommand& command) override;
+
+private:
+	SipResponseSink& sip;
+};
+
+/**
+ * @brief SHUTDOWN, power is cut after the ACK, everything that is only in the HyperRAM goes to the flash first
+ */
+class ShutdownHandler : public SipCommandHandler
+{
+public:
+	ShutdownHandler(SipResponseSink& sip, Serial& obc, MemoryContext& memory, Experiment** experiments, uint8_t experiment_count)
+	: sip(sip), obc(obc), memory(memory), experiments(experiments), experiment_count(experiment_count) {}
+	void handle(SIPCommand& command) override;
+
+private:
+	SipResponseSink& sip;
+	Serial& obc;
+	MemoryContext& memory;
+	Experiment** experiments;
+	uint8_t experiment_count;
+};
+
+/**
+ * @brief TEST_START, TEST_STATUS and TESTDATA, experiments are numbered by their index in experiments
+ */
+class ExperimentCommandHandler : public SipCommandHandler
+{
+public:
+	ExperimentCommandHandler(SipResponseSink& sip, ExperimentManager& manager, Experiment** experiments, uint8_t experiment_count)
+	: sip(sip), manager(manager), experiments(experiments), experiment_count(experiment_count) {}
+	void handle(SIPCommand& command) override;
+
+private:
+	void testStart(SIPCommand& command);
+	void testStatus(SIPCommand& command);
+	void testData(SIPCommand& command);
+
+	SipResponseSink& sip;
+	ExperimentManager& manager;
+	Experiment** experiments;
+	uint8_t experiment_count;
+	uint8_t current_test = 0;
+};
+
+/**
+ * @brief MEMORY_WRITE_INIT and MEMORY_WRITE_DATA, writes the following data chunks to the flash or HyperRAM
+ *
+ * In pipelined mode every chunk carries its offset and every ACK the amount of Bytes written in a row so far,
+ * so the host can keep several chunks in flight and goes back to that offset when one got lost.
+ */
+class MemoryWriteHandler : public SipCommandHandler
+{
+public:
+	MemoryWriteHandler(SipResponseSink& sip, MemoryContext& memory) : sip(sip), memory(memory) {}
+	void handle(SIPCommand& command) override;
+
+private:
+	/* Chunk of a verified flash write, acked once it has been programmed and read back */
+	struct VerifyChunk
+	{
+		SipResponseSink* sip_handler;
+		MX25R6435F* flash;
+		uint32_t address;
+		uint16_t len;
+		uint16_t expected_crc;
+		uint8_t sequence;
+	};
+
+	/**
+	 * @brief Reads the programmed chunk back and sends its CRC16 with the ACK (NACK if it doesnt match the received data)
+	 */
+	static void verifyChunk(const FlashJob& job, void* context);
+
+	void writeInit(SIPCommand& command);
+	void writeData(SIPCommand& command);
+
+	/**
+	 * @brief Cumulative ACK of the pipelined mode, carries write_index (3 Bytes)
+	 */
+	void sendProgress(uint8_t sequence);
+
+	SipResponseSink& sip;
+	MemoryContext& memory;
+
+	bool write_active = false;
+	uint32_t write_addr = 0;
+	bool write_flash = false;
+	bool write_verify = false;
+	bool write_pipelined = false;
+	uint32_t write_len = 0;
+	uint32_t write_index = 0;
+
+	/* A chunk takes at least one job, so there are never more chunks in flight than jobs */
+	VerifyChunk verify_chunks[FLASH_JOB_QUEUE_DEPTH];
+	uint8_t verify_index = 0;
+};
+
+/**
+ * @brief MEMORY_DUMP, answers with up to 4096 Bytes of the flash or HyperRAM, streamed straight out of the memory
+ */
+class MemoryDumpHandler : public SipCommandHandler
+{
+public:
+	MemoryDumpHandler(SipResponseSink& sip, MemoryContext& memory) : sip(sip), memory(memory) {}
+	void handle(SIPCommand& command) override;
+
+private:
+	SipResponseSink& sip;
+	MemoryContext& memory;
+};
+
+/**
+ * @brief BULK_READ and BULK_CONTINUE, streams a range of the HyperRAM, flash or experiment results as numbered frames
+ *
+ * BULK_READ: Source (BulkSource), 3 Bytes Address (offset into the results for BULK_SOURCE_TESTDATA), 4 Bytes Length,
+ * 2 Bytes data per frame, 1 Byte window, 1 Byte experiment (BULK_SOURCE_TESTDATA only). It is ACKed with the frame count
+ * (4 Bytes), the length (3 Bytes) and the window that is actually used (1 Byte), then the first window of frames follows.
+ *
+ * BULK_CONTINUE: List of 4 Byte frame numbers that went missing, these are sent again before the next new frames,
+ * at most window frames per BULK_CONTINUE. Once nothing is missing and all frames were sent it is ACKed and the transfer ends.
+ *
+ * BULK_DATA frames carry the 4 Byte frame number followed by the data of the frame.
+ */
+class BulkReadHandler : public SipCommandHandler
+{
+public:
+	enum BulkSource
+	{
+		BULK_SOURCE_RAM = 0,
+		BULK_SOURCE_FLASH = 1,
+		BULK_SOURCE_TESTDATA = 2,
+	};
+
+	static constexpr uint16_t FRAME_HEADER_SIZE = 4;
+	static constexpr uint16_t FRAME_DATA_MAX = 4096 - FRAME_HEADER_SIZE;
+	static constexpr uint8_t WINDOW_MAX = 64;
+	/* A window is sent from within the main loop, this bounds how long the loop is held up */
+	static constexpr uint32_t WINDOW_BYTES_MAX = 16384;
+
+	BulkReadHandler(SipResponseSink& sip, MemoryContext& memory, Experiment** experiments, uint8_t experiment_count)
+	: sip(sip), memory(memory), experiments(experiments), experiment_count(experiment_count) {}
+	void handle(SIPCommand& command) override;
+
+private:
+	void start(SIPCommand& command);
+	void resume(SIPCommand& command);
+	void sendFrame(uint32_t frame);
+
+	SipResponseSink& sip;
+	MemoryContext& memory;
+	Experiment** experiments;
+	uint8_t experiment_count;
+
+	bool active = false;
+	uint8_t sequence = 0;
+	bool from_flash = false;
+	/* HyperRAM or flash address of frame 0 */
+	uint32_t address = 0;
+	uint32_t length = 0;
+	uint16_t frame_size = 0;
+	uint8_t window = 0;
+	uint32_t frame_count = 0;
+	/* First frame that has never been sent */
+	uint32_t next_frame = 0;
+};
+
+/**
+ * @brief SLOT_REGISTER, enters a Bitstream that has been uploaded with MEMORY_WRITE into the slot table
+ *
+ * Slot (1 Byte), 3 Bytes flash offset, 3 Bytes length, 2 Bytes version. The ACK carries the CRC32 of the image (4 Bytes),
+ * it is NACKed if the slot doesnt exist or the image leaves the flash.
+ */
+class SlotRegisterHandler : public SipCommandHandler
+{
+public:
+	SlotRegisterHandler(SipResponseSink& sip, MemoryContext& memory, ICE40PROG& programmer) : sip(sip), memory(memory), programmer(programmer) {}
+	void handle(SIPCommand& command) override;
+
+private:
+	SipResponseSink& sip;
+	MemoryContext& memory;
+	ICE40PROG& programmer;
+};
+
+/**
+ * @brief LOG_LEVEL, first Byte is the Module (LOG_MODULE_ALL for all), second the Level, the ACK carries all Levels
+ */
+class LogLevelHandler : public SipCommandHandler
+{
+public:
+	LogLevelHandler(SipResponseSink& sip) : sip(sip) {}
+	void handle(SIPCommand& command) override;
+
+private:
+	SipResponseSink& sip;
+};
+
+#endif // SIPCOMMANDS_H_
@@ -42,10 +42,7 @@ public:
 		sip_data.length_without_crc_and_length_field = sip_data.length - sizeof(sip_data.crc) - sizeof(sip_data.length);
 		sip_data.data_length = data_length;
 
-		uint16_t size_increase = SIPUtil::hdlc_encode(reinterpret_cast<uint8_t*>(&sip_data), sip_data.length + 2);
-		sip_data.length_without_crc_and_length_field += size_increase;
-		sip_data.data_length += size_increase;
-
+		/* Stays decoded, SIPHandler::sendResponse() escapes it while sending */
 		return SUCCESS;
 	}
 
@@ -0,0 +1,59 @@
+#ifndef SIP_RESPONSE_SINK_H_
+#define SIP_RESPONSE_SINK_H_
+
+#include <stdint.h>
+
+#define ACK 1
+#define NACK 0
+/* Maximum amount of extra data behind the ACK/NACK byte */
+#define ACK_DATA_SIZE 8
+
+#define POWERED_ON 1
+#define POWERED_OFF 0
+
+enum Response
+{
+	ACK_NACK_RESPONSE_ID = 8,
+	TESTDATA_RESPONSE_ID = 0x0E,
+	TEST_STATUS_RESPONSE_ID = 0x0D,
+	HOUSEKEEPINGDATA_RESPONSE_ID = 10,
+	MEMORY_DUMP_RESPONSE_ID = 11,
+	BULK_DATA_RESPONSE_ID = 0x0F,
+};
+
+/**
+ * @brief Everything the command handlers answer through, implemented by the SIPHandler on the target.
+ * Kept free of any Hardware includes so the handlers can be driven by a host test
+ */
+class SipResponseSink
+{
+public:
+	virtual ~SipResponseSink() {}
+
+	/**
+	 * @brief Starts a response frame, data_len Bytes follow through writeResponseData() before endResponse()
+	 */
+	virtual void beginResponse(uint8_t sequence, uint8_t power_state, uint8_t response_type, uint16_t data_len) = 0;
+
+	/**
+	 * @brief Appends data to the started response, can be called as often as needed
+	 */
+	virtual void writeResponseData(const uint8_t* data, uint32_t len) = 0;
+
+	/**
+	 * @brief Closes the started response
+	 */
+	virtual void endResponse() = 0;
+
+	virtual void sendAck(uint8_t sequence) = 0;
+	virtual void sendNack(uint8_t sequence) = 0;
+
+	/**
+	 * @brief Sends an ACK or NACK with additional data behind the ACK/NACK byte
+	 *
+	 * @param len at most ACK_DATA_SIZE, the rest is cut off
+	 */
+	virtual void sendAckNack(uint8_t sequence, uint8_t ack, const uint8_t* data, uint16_t len) = 0;
+};
+
+#endif // SIP_RESPONSE_SINK_H_
@@ -26,12 +26,42 @@ public:
 	uint8_t readByte();
 	void writeByte(uint8_t byte);
 
+	/**
+	 * @brief Reads len bytes back to back, the next transfer is started
+	 * right after the received byte of the last one has been fetched
+	 */
+	void readBurst(uint8_t* dst, uint32_t len);
+	void readBurst(volatile uint8_t* dst, uint32_t len);
+
+	/**
+	 * @brief Starts a burst that is read byte by byte, the caller can do other work while each byte is shifted in.
+	 * beginReadBurst() starts the first transfer, nextReadBurst() fetches the received byte and starts the next one
+	 *
+	 * @param more false for the last byte of the burst, no further transfer is started then
+	 */
+	void beginReadBurst();
+	uint8_t nextReadBurst(bool more);
+
+	/**
+	 * @brief Writes len bytes, the next byte is already loaded while the last one is still shifted out
+	 */
+	void writeBurst(const uint8_t* src, uint32_t len);
+
+	/**
+	 * @brief Reads read_len bytes into dst while src is written to the target SPI,
+	 * both masters are kept busy at the same time, so the slower transfer hides the other one
+	 */
+	void readBurstWhileWriting(uint8_t* dst, uint32_t read_len, SPI& target, const uint8_t* src, uint32_t write_len);
+
 private:
 	void startTX();
 
 	uint32_t spi_base_addr;
 	volatile uint32_t* BUSY_REG = 0;
 
+	/* Control Register content that starts a transfer of the running burst */
+	uint32_t burst_content = 0;
+
 	/* Control Register Offsets */
 	static constexpr uint32_t SPI_TX_OFFSET 		= 0x00;
 	static constexpr uint32_t SPI_RX_OFFSET 		= 0x04;
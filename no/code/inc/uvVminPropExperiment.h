@@ -7,7 +7,7 @@
 #include "gpio.h"
 
 #define EXPERIMENT_ID 0
-#define ICE40_CONFIG Exp0
+#define ICE40_CONFIG SLOT_EXP0
 
 #define GPIO_COUNTER_EN ice40_io_vio_5
 #define GPIO_A0 ice40_io_vio_0
@@ -24,7 +24,7 @@ class UvVminPropExperiment: public Experiment
 {
 public:
     UvVminPropExperiment(SensorContext& sensorcontext, ICE40PROG& programmer, MemoryContext& memorycontext, Serial& iceUART) :
-	Experiment(sensorcontext, programmer, memorycontext, iceUART), timer1(TimerID::TIMER1){}
+	Experiment(sensorcontext, programmer, memorycontext, iceUART, "uvvminprop"), timer1(TimerID::TIMER1){}
 
 	bool init();
 	ExperimentState run();
@@ -35,16 +35,12 @@ private:
 	uint16_t voltage = 0;
 	uint8_t remainigTestIntervalls = 0;
 	uint8_t remainigRunsPerIntervall = 0;
-	uint16_t ramPos=0;
 	
 	void setUpTest(void);
 	bool makeTest(void);
 	void readingSensors(void);
 	void delayms(uint32_t timeout);
 	uint32_t runningTime(void);		
-	void hyperramAddUint8_t(uint8_t data);
-	void hyperramAddUint16_t(uint16_t data);
-	void hyperramAddUint32_t(uint32_t data);
 };
 
 #endif // UVVMINPROPEXPERIMENT_H_
\ No newline at end of file
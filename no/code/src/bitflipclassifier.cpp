@@ -0,0 +1,173 @@
+#define LOG_MODULE LOG_MODULE_MEMORY
+#include "bitflipclassifier.h"
+
+BitFlipClassifier::BitFlipClassifier(MemoryContext& memory)
+{
+	HyperRamRegion* history_region = memory.arena.allocate("flip history", FLIP_SECTOR_COUNT * sizeof(SectorHistory));
+	HyperRamRegion* log_region = memory.arena.allocate("flip log", FLIP_LOG_ENTRIES * sizeof(ClassifiedFlip));
+
+	history = reinterpret_cast<volatile SectorHistory*>(history_region->getData());
+	flip_log = reinterpret_cast<volatile ClassifiedFlip*>(log_region->getData());
+
+	if(history_region->getSize() < FLIP_SECTOR_COUNT * sizeof(SectorHistory))
+	{
+		LOGWARN("No HyperRAM left for the bit flip history, events are dropped");
+		return;
+	}
+
+	log_entries = log_region->getSize() / sizeof(ClassifiedFlip);
+	if(log_entries > FLIP_LOG_ENTRIES)
+	{
+		log_entries = FLIP_LOG_ENTRIES;
+	}
+}
+
+void BitFlipClassifier::reset()
+{
+	for(uint32_t sector = 0; log_entries && sector < FLIP_SECTOR_COUNT; sector++)
+	{
+		for(uint32_t type = 0; type < FLIP_TYPE_COUNT; type++)
+		{
+			history[sector].count[type] = 0;
+		}
+
+		history[sector].next = 0;
+
+		for(uint32_t i = 0; i <= RECENT_MASK; i++)
+		{
+			history[sector].recent[i] = EMPTY;
+		}
+	}
+
+	for(uint32_t type = 0; type < FLIP_TYPE_COUNT; type++)
+	{
+		counts[type] = 0;
+	}
+
+	log_index = 0;
+	dropped = 0;
+	has_last = false;
+}
+
+void BitFlipClassifier::onMismatch(const ScanMismatch& mismatch)
+{
+	if(!log_entries)
+	{
+		dropped++;
+		return;
+	}
+
+	uint32_t sector = (mismatch.address / FLIP_SECTOR_SIZE) & (FLIP_SECTOR_COUNT - 1);
+	uint16_t offset = mismatch.address & (FLIP_SECTOR_SIZE - 1);
+	volatile SectorHistory& sector_history = history[sector];
+
+	FlipType type = FLIP_SEU;
+
+	/* Sticky: one of the flipped bits has already been seen in an earlier pass */
+	for(uint32_t i = 0; i <= RECENT_MASK; i++)
+	{
+		uint16_t key = sector_history.recent[i];
+		if(key != EMPTY && (key >> 3) == offset && (mismatch.flipped & (1 << (key & 0x07))))
+		{
+			type = FLIP_STICKY;
+			break;
+		}
+	}
+
+	bool near_last = has_last && mismatch.pass == last_pass && (mismatch.address - last_address) <= FLIP_CLUSTER_DISTANCE;
+
+	/* Cluster: more than one bit in the byte, or close to the last flip */
+	if(type == FLIP_SEU && ((mismatch.flipped & (mismatch.flipped - 1)) || near_last))
+	{
+		type = FLIP_CLUSTER;
+	}
+
+	/* The last flip turned out to be part of a cluster, reclassify it in place */
+	if(near_last && last_type == FLIP_SEU)
+	{
+		volatile SectorHistory& last_history = history[(last_address / FLIP_SECTOR_SIZE) & (FLIP_SECTOR_COUNT - 1)];
+		/* Saturated counters stay where they are, just like on increment */
+		if(last_history.count[FLIP_SEU] != 0 && last_history.count[FLIP_SEU] != 0xFFFF)
+		{
+			last_history.count[FLIP_SEU]--;
+		}
+		if(last_history.count[FLIP_CLUSTER] != 0xFFFF)
+		{
+			last_history.count[FLIP_CLUSTER]++;
+		}
+		counts[FLIP_SEU]--;
+		counts[FLIP_CLUSTER]++;
+
+		if(last_log_index < log_index)
+		{
+			flip_log[last_log_index].type = FLIP_CLUSTER;
+		}
+	}
+
+	if(sector_history.count[type] != 0xFFFF)
+	{
+		sector_history.count[type]++;
+	}
+	counts[type]++;
+
+	remember(sector_history, offset, mismatch.flipped);
+
+	ClassifiedFlip flip;
+	flip.address = mismatch.address;
+	flip.pass = mismatch.pass;
+	flip.flipped = mismatch.flipped;
+	flip.type = type;
+
+	/* Points past the log if the event gets dropped, so it wont be reclassified */
+	last_log_index = log_index < FLIP_LOG_ENTRIES ? log_index : FLIP_LOG_ENTRIES;
+	append(flip);
+
+	has_last = true;
+	last_address = mismatch.address;
+	last_pass = mismatch.pass;
+	last_type = type;
+}
+
+void BitFlipClassifier::remember(volatile SectorHistory& sector_history, uint16_t offset, uint8_t flipped)
+{
+	for(uint8_t bit = 0; bit < 8; bit++)
+	{
+		if(!(flipped & (1 << bit)))
+		{
+			continue;
+		}
+
+		uint16_t key = (offset << 3) | bit;
+		bool known = false;
+
+		for(uint32_t i = 0; i <= RECENT_MASK; i++)
+		{
+			if(sector_history.recent[i] == key)
+			{
+				known = true;
+				break;
+			}
+		}
+
+		if(!known)
+		{
+			sector_history.recent[sector_history.next & RECENT_MASK] = key;
+			sector_history.next = (sector_history.next + 1) & RECENT_MASK;
+		}
+	}
+}
+
+void BitFlipClassifier::append(const ClassifiedFlip& flip)
+{
+	if(log_index >= log_entries)
+	{
+		dropped++;
+		return;
+	}
+
+	flip_log[log_index].address = flip.address;
+	flip_log[log_index].pass = flip.pass;
+	flip_log[log_index].flipped = flip.flipped;
+	flip_log[log_index].type = flip.type;
+	log_index++;
+}
@@ -0,0 +1,124 @@
+#define LOG_MODULE LOG_MODULE_MEMORY
+#include "bitstreamslots.h"
+
+BitstreamSlotTable::BitstreamSlotTable(MX25R6435F& flash) : flash(flash)
+{
+	loadDefaults();
+}
+
+bool BitstreamSlotTable::load()
+{
+	BitstreamSlotTableHeader header;
+	BitstreamSlot table[SLOT_COUNT];
+
+	flash.read(SLOT_TABLE_OFFSET, reinterpret_cast<uint8_t*>(&header), sizeof(header));
+	flash.read(SLOT_TABLE_OFFSET + sizeof(header), reinterpret_cast<uint8_t*>(table), sizeof(table));
+
+	if(header.magic != SLOT_TABLE_MAGIC || header.crc != crc32(reinterpret_cast<uint8_t*>(table), sizeof(table)))
+	{
+		LOGWARN("No valid Bitstream slot table, using the fixed layout");
+		loadDefaults();
+		return false;
+	}
+
+	for(uint8_t i = 0; i < SLOT_COUNT; i++)
+	{
+		slots[i] = table[i];
+
+		if(slots[i].flags & SLOT_FLAG_VALID)
+		{
+			LOGINFO("Slot %d: offset %d, length %d, version %d", i, slots[i].offset, slots[i].length, slots[i].version);
+		}
+	}
+
+	return true;
+}
+
+const BitstreamSlot* BitstreamSlotTable::get(uint8_t id)
+{
+	if(id >= SLOT_COUNT || !(slots[id].flags & SLOT_FLAG_VALID))
+	{
+		return nullptr;
+	}
+
+	return &slots[id];
+}
+
+bool BitstreamSlotTable::registerSlot(uint8_t id, uint32_t offset, uint32_t length, uint16_t version)
+{
+	if(id >= SLOT_COUNT)
+	{
+		return false;
+	}
+
+	slots[id].offset = offset;
+	slots[id].length = length;
+	slots[id].crc = calculateCRC(offset, length);
+	slots[id].version = version;
+	slots[id].flags = SLOT_FLAG_VALID;
+
+	uint8_t header[CODEC_HEADER_SIZE];
+	uint32_t raw_length;
+	flash.read(offset, header, sizeof(header));
+	if(length >= CODEC_HEADER_SIZE && BitstreamCodec::parseHeader(header, raw_length))
+	{
+		slots[id].flags |= SLOT_FLAG_COMPRESSED;
+		LOGINFO("Slot %d is compressed, %d bytes raw", id, raw_length);
+	}
+
+	store();
+
+	LOGINFO("Registered slot %d: offset %d, length %d, CRC 0x%X", id, offset, length, slots[id].crc);
+	return true;
+}
+
+uint32_t BitstreamSlotTable::calculateCRC(uint32_t offset, uint32_t length)
+{
+	uint8_t chunk[CRC_CHUNK_SIZE];
+	uint32_t crc = CRC32_INIT;
+
+	for(uint32_t index = 0; index < length; index += CRC_CHUNK_SIZE)
+	{
+		uint32_t chunk_len = MIN(CRC_CHUNK_SIZE, length - index);
+
+		flash.read(offset + index, chunk, chunk_len);
+		crc = crc32_update(crc, chunk, chunk_len);
+	}
+
+	return crc32_final(crc);
+}
+
+void BitstreamSlotTable::loadDefaults()
+{
+	for(uint8_t i = 0; i < SLOT_COUNT; i++)
+	{
+		slots[i].offset = 0;
+		slots[i].length = 0;
+		slots[i].crc = 0;
+		slots[i].version = 0;
+		slots[i].flags = 0;
+	}
+
+	for(uint8_t i = SLOT_EXP0; i <= SLOT_EXP2; i++)
+	{
+		slots[i].offset = USERSPACE_OFFSET + i * SIZE_ICE40_CONFIG;
+		slots[i].length = ICE40_FILESIZE;
+		slots[i].flags = SLOT_FLAG_VALID | SLOT_FLAG_NO_CRC;
+	}
+
+	/* Where the ISFD image has been uploaded so far, overlaps the start of SLOT_EXP1 */
+	slots[SLOT_ISFD].offset = USERSPACE_OFFSET + ICE40_FILESIZE;
+	slots[SLOT_ISFD].length = ICE40_FILESIZE;
+	slots[SLOT_ISFD].flags = SLOT_FLAG_VALID | SLOT_FLAG_NO_CRC;
+}
+
+void BitstreamSlotTable::store()
+{
+	BitstreamSlotTableHeader header;
+	header.magic = SLOT_TABLE_MAGIC;
+	header.crc = crc32(reinterpret_cast<uint8_t*>(slots), sizeof(slots));
+
+	flash.eraseSector(SLOT_TABLE_OFFSET);
+	flash.write(SLOT_TABLE_OFFSET, reinterpret_cast<uint8_t*>(&header), sizeof(header));
+	flash.write(SLOT_TABLE_OFFSET + sizeof(header), reinterpret_cast<uint8_t*>(slots), sizeof(slots));
+}
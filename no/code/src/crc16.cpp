@@ -37,7 +37,11 @@ static const uint16_t ccitt_hash[] = {
 
 uint16_t crc16_ccitt(const uint8_t* buffer, size_t size)
 {
-    uint16_t crc = 0xFFFF;
+    return crc16_ccitt_update(CRC16_INIT, buffer, size);
+}
+
+uint16_t crc16_ccitt_update(uint16_t crc, const uint8_t* buffer, size_t size)
+{
     while (size-- > 0)
     {
     	crc = (crc << 8) ^ ccitt_hash[((crc >> 8) ^ *(buffer++)) & 0x00FF];
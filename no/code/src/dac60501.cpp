@@ -1,3 +1,4 @@
+#define LOG_MODULE LOG_MODULE_SENSORS
 #include "dac60501.h"
 
 DAC60501::DAC60501(I2C& i2c_dev): i2c(i2c_dev) {}
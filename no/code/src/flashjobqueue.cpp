@@ -0,0 +1,126 @@
+#include "flashjobqueue.h"
+
+FlashJobQueue::FlashJobQueue(MX25R6435F& flash) : flash(flash)
+{
+}
+
+bool FlashJobQueue::submitProgram(uint32_t address, const uint8_t* data, uint32_t len, FlashJobCallback callback, void* context)
+{
+	uint32_t first_page = address & ~(MX25R6435F::PAGE_SIZE - 1);
+	uint32_t pages = (address + len - first_page + MX25R6435F::PAGE_SIZE - 1) / MX25R6435F::PAGE_SIZE;
+
+	if(len == 0 || pages > freeSlots())
+	{
+		return false;
+	}
+
+	uint32_t index = 0;
+	while(index < len)
+	{
+		uint32_t bytes_till_boundary = MX25R6435F::PAGE_SIZE - ((address + index) & (MX25R6435F::PAGE_SIZE - 1));
+		uint32_t bytes_to_write = MIN(len - index, bytes_till_boundary);
+
+		FlashJob& job = push();
+		job.type = FLASH_JOB_PROGRAM;
+		job.address = address + index;
+		job.len = bytes_to_write;
+		for(uint32_t i = 0; i < bytes_to_write; i++)
+		{
+			job.data[i] = data[index + i];
+		}
+
+		index += bytes_to_write;
+
+		/* Only the last page reports back */
+		job.callback = (index >= len) ? callback : nullptr;
+		job.context = context;
+	}
+
+	return true;
+}
+
+bool FlashJobQueue::submitErase(uint32_t address, uint32_t len, FlashJobCallback callback, void* context)
+{
+	if(freeSlots() == 0)
+	{
+		return false;
+	}
+
+	FlashJob& job = push();
+	job.type = FLASH_JOB_ERASE;
+	job.address = address;
+	job.len = len;
+	job.callback = callback;
+	job.context = context;
+
+	return true;
+}
+
+void FlashJobQueue::poll()
+{
+	if(count == 0)
+	{
+		return;
+	}
+
+	FlashJob& job = jobs[head];
+
+	if(!started)
+	{
+		if(job.type == FLASH_JOB_ERASE)
+		{
+			flash.beginErase(job.address, job.len);
+		}
+		else
+		{
+			/* Wait for whatever has been started outside the queue */
+			if(!flash.pollErase() || flash.isBusy())
+			{
+				return;
+			}
+			flash.startPageProgram(job.address, job.data, job.len);
+		}
+
+		started = true;
+		return;
+	}
+
+	bool done = (job.type == FLASH_JOB_ERASE) ? flash.pollErase() : !flash.isBusy();
+	if(!done)
+	{
+		return;
+	}
+
+	if(job.callback)
+	{
+		job.callback(job, job.context);
+	}
+
+	started = false;
+	head = (head + 1) & QUEUE_MASK;
+	count--;
+}
+
+void FlashJobQueue::waitForSlots(uint32_t slots)
+{
+	while(freeSlots() < slots)
+	{
+		poll();
+	}
+}
+
+void FlashJobQueue::waitIdle()
+{
+	while(count)
+	{
+		poll();
+	}
+}
+
+FlashJob& FlashJobQueue::push()
+{
+	FlashJob& job = jobs[(head + count) & QUEUE_MASK];
+	count++;
+
+	return job;
+}
@@ -0,0 +1,321 @@
+#define LOG_MODULE LOG_MODULE_MEMORY
+#include "flashjournal.h"
+#include <stddef.h>
+
+FlashJournal::FlashJournal(MX25R6435F& flash, FlashJobQueue& jobs) : flash(flash), jobs(jobs)
+{
+}
+
+bool FlashJournal::track(uint8_t stream, HyperRamRegion* region)
+{
+	if(stream >= JOURNAL_MAX_STREAMS || streams[stream].region)
+	{
+		return false;
+	}
+
+	streams[stream].region = region;
+	streams[stream].mirrored = region->getUsed();
+	streams[stream].generation = region->getGeneration();
+	streams[stream].restart = false;
+
+	return true;
+}
+
+void FlashJournal::recover()
+{
+	jobs.waitIdle();
+
+	JournalPageHeader header;
+	uint8_t payload[JOURNAL_PAYLOAD_SIZE];
+	bool found = false;
+	uint32_t last_page = 0;
+	uint32_t last_sequence = 0;
+
+	/* Sectors are filled from their first page on, so the first pages are enough to find the newest sector */
+	for(uint32_t sector = 0; sector < JOURNAL_SECTORS; sector++)
+	{
+		uint32_t page = sector * JOURNAL_PAGES_PER_SECTOR;
+		if(readPage(page, header, payload) && (!found || header.sequence > last_sequence))
+		{
+			found = true;
+			last_page = page;
+			last_sequence = header.sequence;
+		}
+	}
+
+	if(!found)
+	{
+		LOGINFO("Flash journal is empty");
+		head_page = 0;
+		sequence = 0;
+		head_erased = false;
+		return;
+	}
+
+	uint32_t first_page = last_page;
+	for(uint32_t page = first_page + 1; page < first_page + JOURNAL_PAGES_PER_SECTOR; page++)
+	{
+		if(readPage(page, header, payload) && header.sequence > last_sequence)
+		{
+			last_page = page;
+			last_sequence = header.sequence;
+		}
+	}
+
+	sequence = last_sequence + 1;
+	head_page = (last_page + 1) % JOURNAL_PAGES;
+
+	/* A page that was torn by a power loss cant be programmed again, continue behind it */
+	while(head_page % JOURNAL_PAGES_PER_SECTOR != 0 && !isErased(head_page))
+	{
+		head_page = (head_page + 1) % JOURNAL_PAGES;
+	}
+	head_erased = (head_page % JOURNAL_PAGES_PER_SECTOR != 0);
+
+	LOGINFO("Flash journal tail: page %d, sequence %d", head_page, sequence);
+}
+
+uint32_t FlashJournal::restore()
+{
+	if(sequence == 0)
+	{
+		return 0;
+	}
+
+	jobs.waitIdle();
+
+	JournalPageHeader header;
+	uint8_t payload[JOURNAL_PAYLOAD_SIZE];
+	uint32_t restored = 0;
+
+	/* Lowest offset of each stream that is still in the ring, everything below went with the reclaimed sectors */
+	uint32_t restored_from[JOURNAL_MAX_STREAMS];
+	for(uint32_t id = 0; id < JOURNAL_MAX_STREAMS; id++)
+	{
+		restored_from[id] = UINT32_MAX;
+	}
+
+	/* The sector behind the head holds the oldest data, the one of the head the newest */
+	uint32_t head_sector = head_page / JOURNAL_PAGES_PER_SECTOR;
+	for(uint32_t i = 1; i <= JOURNAL_SECTORS; i++)
+	{
+		uint32_t first_page = ((head_sector + i) % JOURNAL_SECTORS) * JOURNAL_PAGES_PER_SECTOR;
+
+		for(uint32_t page = first_page; page < first_page + JOURNAL_PAGES_PER_SECTOR; page++)
+		{
+			if(!readPage(page, header, payload))
+			{
+				/* Nothing has been written behind an erased page */
+				if(header.magic == 0xFFFF)
+				{
+					break;
+				}
+				continue;
+			}
+
+			if(header.stream >= JOURNAL_MAX_STREAMS || !streams[header.stream].region)
+			{
+				continue;
+			}
+
+			HyperRamRegion* region = streams[header.stream].region;
+			if(header.flags & JOURNAL_FLAG_RESTART)
+			{
+				region->used = 0;
+				restored_from[header.stream] = 0;
+			}
+
+			if(header.offset + header.length > region->size)
+			{
+				continue;
+			}
+
+			for(uint32_t n = 0; n < header.length; n++)
+			{
+				region->data[header.offset + n] = payload[n];
+			}
+
+			if(header.offset + header.length > region->used)
+			{
+				region->used = header.offset + header.length;
+			}
+
+			restored_from[header.stream] = MIN(restored_from[header.stream], header.offset);
+			restored++;
+		}
+	}
+
+	for(uint32_t id = 0; id < JOURNAL_MAX_STREAMS; id++)
+	{
+		if(streams[id].region)
+		{
+			HyperRamRegion* region = streams[id].region;
+
+			/*
+			 * The start of the region is gone, whatever is left in the HyperRAM there is not the lost data.
+			 * Zeros would end the decoding right there, padding is skipped up to the restored records
+			 */
+			if(restored_from[id] != UINT32_MAX && restored_from[id] > 0)
+			{
+				for(uint32_t n = 0; n < restored_from[id]; n++)
+				{
+					region->data[n] = RECORD_PAD;
+				}
+				LOGWARN("First %d bytes of %s are no longer in the flash journal, padded", restored_from[id], region->getName());
+			}
+
+			streams[id].mirrored = region->getUsed();
+			streams[id].generation = region->getGeneration();
+			LOGINFO("Restored %d bytes of %s from the flash journal", streams[id].mirrored, streams[id].region->getName());
+		}
+	}
+
+	return restored;
+}
+
+void FlashJournal::poll()
+{
+	/* Leave a slot for everyone else */
+	if(jobs.freeSlots() < 2)
+	{
+		return;
+	}
+
+	for(uint32_t i = 0; i < JOURNAL_MAX_STREAMS; i++)
+	{
+		uint8_t id = (next_stream + i) % JOURNAL_MAX_STREAMS;
+		if(appendPage(streams[id], id, false))
+		{
+			next_stream = (id + 1) % JOURNAL_MAX_STREAMS;
+			return;
+		}
+	}
+}
+
+void FlashJournal::flush()
+{
+	for(uint8_t id = 0; id < JOURNAL_MAX_STREAMS; id++)
+	{
+		do
+		{
+			jobs.waitForSlots(1);
+		}
+		while(appendPage(streams[id], id, true));
+	}
+
+	jobs.waitIdle();
+	LOGINFO("Flash journal flushed, sequence %d", sequence);
+}
+
+bool FlashJournal::appendPage(Stream& stream, uint8_t id, bool partial)
+{
+	if(!stream.region)
+	{
+		return false;
+	}
+
+	if(stream.region->getGeneration() != stream.generation)
+	{
+		/* The region has been cleared since the last page, it may have grown past mirrored again already */
+		stream.generation = stream.region->getGeneration();
+		stream.mirrored = 0;
+		stream.restart = true;
+	}
+
+	uint32_t used = stream.region->getUsed();
+
+	uint32_t pending = used - stream.mirrored;
+	if(pending == 0 || (!partial && pending < JOURNAL_PAYLOAD_SIZE))
+	{
+		return false;
+	}
+
+	/* Entering a new sector, the oldest data in the ring is dropped */
+	if(!head_erased)
+	{
+		if(!jobs.submitErase(pageAddress(head_page), SECTOR_SIZE))
+		{
+			return false;
+		}
+		head_erased = true;
+		return true;
+	}
+
+	JournalPageHeader header;
+	header.magic = JOURNAL_MAGIC;
+	header.stream = id;
+	header.flags = stream.restart ? JOURNAL_FLAG_RESTART : 0;
+	header.sequence = sequence;
+	header.offset = stream.mirrored;
+	header.length = MIN(pending, JOURNAL_PAYLOAD_SIZE);
+	header.reserved = 0;
+	header.crc = 0;
+
+	uint8_t page[MX25R6435F::PAGE_SIZE];
+	memcpy(page, &header, sizeof(header));
+
+	volatile uint8_t* src = stream.region->getData() + stream.mirrored;
+	for(uint32_t n = 0; n < header.length; n++)
+	{
+		page[sizeof(header) + n] = src[n];
+	}
+
+	header.crc = crc32(page, sizeof(header) + header.length);
+	memcpy(page + offsetof(JournalPageHeader, crc), &header.crc, sizeof(header.crc));
+
+	if(!jobs.submitProgram(pageAddress(head_page), page, sizeof(header) + header.length))
+	{
+		return false;
+	}
+
+	stream.mirrored += header.length;
+	stream.restart = false;
+	sequence++;
+
+	head_page = (head_page + 1) % JOURNAL_PAGES;
+	if(head_page % JOURNAL_PAGES_PER_SECTOR == 0)
+	{
+		head_erased = false;
+	}
+
+	return true;
+}
+
+bool FlashJournal::readPage(uint32_t page, JournalPageHeader& header, uint8_t* payload)
+{
+	flash.read(pageAddress(page), reinterpret_cast<uint8_t*>(&header), sizeof(header));
+
+	if(header.magic != JOURNAL_MAGIC || header.length > JOURNAL_PAYLOAD_SIZE)
+	{
+		return false;
+	}
+
+	flash.read(pageAddress(page) + sizeof(header), payload, header.length);
+
+	JournalPageHeader check = header;
+	check.crc = 0;
+
+	uint32_t crc = crc32_update(CRC32_INIT, reinterpret_cast<uint8_t*>(&check), sizeof(check));
+	crc = crc32_update(crc, payload, header.length);
+
+	return crc32_final(crc) == header.crc;
+}
+
+bool FlashJournal::isErased(uint32_t page)
+{
+	uint8_t buffer[64];
+
+	for(uint32_t offset = 0; offset < MX25R6435F::PAGE_SIZE; offset += sizeof(buffer))
+	{
+		flash.read(pageAddress(page) + offset, buffer, sizeof(buffer));
+		for(uint32_t i = 0; i < sizeof(buffer); i++)
+		{
+			if(buffer[i] != 0xFF)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,79 @@
+#define LOG_MODULE LOG_MODULE_MEMORY
+#include "hyperramarena.h"
+
+HyperRamArena::HyperRamArena(volatile uint8_t* base, uint32_t size) : base(base), size(size)
+{
+	strncpy(overflow_region.name, "overflow", ARENA_NAME_SIZE - 1);
+	overflow_region.data = base;
+}
+
+HyperRamRegion* HyperRamArena::allocate(const char* name, uint32_t region_size)
+{
+	HyperRamRegion* existing = find(name);
+	if(existing)
+	{
+		if(existing->size < region_size)
+		{
+			LOGWARN("HyperRAM region %s has %d bytes, %d requested", name, existing->size, region_size);
+		}
+		return existing;
+	}
+
+	uint32_t aligned_size = (region_size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+
+	if(region_count >= ARENA_MAX_REGIONS || aligned_size > size - top)
+	{
+		LOGWARN("HyperRAM is full, region %s with %d bytes doesnt fit", name, region_size);
+		overflow_region.overflows++;
+		return &overflow_region;
+	}
+
+	HyperRamRegion& region = regions[region_count++];
+	strncpy(region.name, name, ARENA_NAME_SIZE - 1);
+	region.data = base + top;
+	region.offset = top;
+	region.size = aligned_size;
+	region.used = 0;
+	region.overflows = 0;
+
+	top += aligned_size;
+
+	return &region;
+}
+
+HyperRamRegion* HyperRamArena::find(const char* name)
+{
+	for(uint32_t i = 0; i < region_count; i++)
+	{
+		if(strncmp(regions[i].name, name, ARENA_NAME_SIZE - 1) == 0)
+		{
+			return &regions[i];
+		}
+	}
+
+	return nullptr;
+}
+
+HyperRamRegion* HyperRamArena::findOverlap(uint32_t offset, uint32_t len)
+{
+	for(uint32_t i = 0; i < region_count; i++)
+	{
+		if(offset < regions[i].offset + regions[i].size && regions[i].offset < offset + len)
+		{
+			return &regions[i];
+		}
+	}
+
+	return nullptr;
+}
+
+void HyperRamArena::printLayout()
+{
+	for(uint32_t i = 0; i < region_count; i++)
+	{
+		HyperRamRegion& region = regions[i];
+		LOGINFO("HyperRAM %s: %d - %d, %d used, %d overflows", region.name, region.offset, region.offset + region.size, region.used, region.overflows);
+	}
+
+	LOGINFO("HyperRAM %d bytes free", getFree());
+}
@@ -0,0 +1,136 @@
+#include "hyperramwriter.h"
+#include <string.h>
+
+void HyperRamWriter::sync()
+{
+	position = region->getUsed();
+	word = 0;
+
+	/* Keep the Bytes in front of the end if it is not word aligned */
+	if(position & 3)
+	{
+		word = reinterpret_cast<volatile uint32_t*>(region->getData())[position >> 2] & ((1u << ((position & 3) * 8)) - 1);
+	}
+
+	synced = true;
+}
+
+void HyperRamWriter::storeWord()
+{
+	reinterpret_cast<volatile uint32_t*>(region->getData())[(position - 1) >> 2] = word;
+}
+
+void HyperRamWriter::put8(uint8_t value)
+{
+	if(!synced)
+	{
+		sync();
+	}
+
+	if(position >= region->getSize())
+	{
+		region->overflows++;
+		return;
+	}
+
+	word |= (uint32_t)value << ((position & 3) * 8);
+	position++;
+
+	if((position & 3) == 0)
+	{
+		storeWord();
+		word = 0;
+		region->used = position;
+	}
+}
+
+void HyperRamWriter::put16(uint16_t value)
+{
+	put8(value >> 8);
+	put8(value & 0xFF);
+}
+
+void HyperRamWriter::put32(uint32_t value)
+{
+	if(!synced)
+	{
+		sync();
+	}
+
+	/* Aligned words go straight to the HyperRAM */
+	if((position & 3) == 0 && position + 4 <= region->getSize())
+	{
+		word = __builtin_bswap32(value);
+		position += 4;
+		storeWord();
+		word = 0;
+		region->used = position;
+		return;
+	}
+
+	put16(value >> 16);
+	put16(value & 0xFFFF);
+}
+
+void HyperRamWriter::putFloat(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	put32(bits);
+}
+
+void HyperRamWriter::putBytes(const uint8_t* src, uint32_t len)
+{
+	if(!synced)
+	{
+		sync();
+	}
+
+	while(len && (position & 3))
+	{
+		put8(*src++);
+		len--;
+	}
+
+	uint32_t words = len >> 2;
+	if(words > (region->getSize() - position) >> 2)
+	{
+		words = (region->getSize() - position) >> 2;
+	}
+
+	volatile uint32_t* dst = reinterpret_cast<volatile uint32_t*>(region->getData()) + (position >> 2);
+	for(uint32_t i = 0; i < words; i++)
+	{
+		dst[i] = src[0] | src[1] << 8 | src[2] << 16 | (uint32_t)src[3] << 24;
+		src += 4;
+	}
+	position += words * 4;
+	region->used = position;
+	len -= words * 4;
+
+	while(len--)
+	{
+		put8(*src++);
+	}
+}
+
+void HyperRamWriter::flush()
+{
+	if(!synced)
+	{
+		return;
+	}
+
+	if(position & 3)
+	{
+		reinterpret_cast<volatile uint32_t*>(region->getData())[position >> 2] = word;
+	}
+
+	region->used = position;
+}
+
+void HyperRamWriter::reset()
+{
+	region->clear();
+	synced = false;
+}
@@ -1,3 +1,4 @@
+#define LOG_MODULE LOG_MODULE_ICE40FLASH
 #include "ice40FlashExperiment.h"
 
 bool ICE40FlashExperiment::init(){	
@@ -30,10 +31,7 @@ bool ICE40FlashExperiment::init(){
 	sensors.enableICE40VIO(true);
 
 	/* ICE40 Programming (ring oscillator: ice40_io_vcore_0 & ice40_io_vcore_1)*/
-	SPI ice40_spi(SPIDevice::ICE40);
-	ice40_spi.init(1, 0);
-	ICE40PROG ice40prog(memory.flash, ice40_spi);
-	ice40prog.programm(USERSPACE_OFFSET);
+	programmer.programm(SLOT_EXP0);
 	delayms(10);
 	sensors.enableICE40OSC(false);
 
@@ -41,12 +39,15 @@ bool ICE40FlashExperiment::init(){
     delayms(1);
 
 	//Logging header
-	hyperramAddUint8_t('E');
-	hyperramAddUint8_t('X');
-	hyperramAddUint8_t('P');
-	hyperramAddUint8_t(EXPERIMENT_ID);
-	hyperramAddUint8_t('#');
+	record.begin(RECORD_EXPERIMENT_START, runningTime());
+	record.put8(EXPERIMENT_ID);
+	record.end();
 
+    uint32_t flashID = test_flash.readID();
+    LOGINFO("Flash ID %x \n", flashID);
+
+	classifier.reset();
+	beginPattern();
 
 	// delayUS(8000000);
 	LOGINFO("run will start\n");
@@ -59,11 +60,32 @@ bool ICE40FlashExperiment::init(){
 
 ExperimentState ICE40FlashExperiment::run(){
 
-    makeTest();
-    LOGINFO("Current Test Case\n");
-    return ExperimentState::TEST_FINISHED;
+	if(phase != PHASE_SCAN)
+	{
+		if(preparePattern())
+		{
+			phase = PHASE_SCAN;
+			scanner.begin(SCAN_START, SCAN_LENGTH, SCAN_SEED);
+		}
+		return ExperimentState::STILL_RUNNING;
+	}
+
+	/* One chunk per call, so SIP and the flash journal keep running during the scan */
+	if(!scanner.step())
+	{
+		return ExperimentState::STILL_RUNNING;
+	}
+
+	recordPass();
+	readingSensors();
+
+	if(scanner.getPass() >= SCAN_PASSES)
+	{
+		return ExperimentState::TEST_FINISHED;
+	}
 
-    	
+	scanner.begin(SCAN_START, SCAN_LENGTH, SCAN_SEED);
+	return ExperimentState::STILL_RUNNING;
 }
 
 bool ICE40FlashExperiment::cleanUp(){
@@ -72,32 +94,91 @@ bool ICE40FlashExperiment::cleanUp(){
 }
 
 
-bool ICE40FlashExperiment::makeTest(){
+void ICE40FlashExperiment::beginPattern(){
 
-    uint32_t flashID = readID();
-    LOGINFO("Flash ID %x \n", flashID);
-    // delayms(20);
-	startTime = timer1.getTime();
-    read(0x0000A324, 8192);
-	endTime = timer1.getTime();
-	
-
-	if (endTime <= startTime) {
-        elapsedTicks += startTime - endTime;
-    } else {
-        // Timer has overflowed
-        elapsedTicks += (0xFFFFFFFF - startTime) + endTime + 1;
-    }
-
-	LOGINFO("StartTime EndTime:: %llu %llu %llu\n", startTime, endTime, elapsedTicks);
-    for (uint16_t i = 0; i < 1024; i++)
-    {
-        LOGINFO("Flash DATA %x \n", flashBuff[i]);
-    }
-    
-    return true;
+	/* Pages left over from a restarted experiment */
+	pattern_jobs.waitIdle();
+
+	uint32_t marker[2];
+	test_flash.read(SCAN_MARKER_ADDRESS, reinterpret_cast<uint8_t*>(marker), sizeof(marker));
+
+	if(marker[0] == SCAN_MARKER_MAGIC && marker[1] == SCAN_SEED)
+	{
+		phase = PHASE_SCAN;
+		scanner.begin(SCAN_START, SCAN_LENGTH, SCAN_SEED);
+		return;
+	}
+
+	LOGINFO("Programming the scan pattern\n");
+	test_flash.beginErase(SCAN_START, SCAN_LENGTH + SECTOR_SIZE);
+	program_offset = 0;
+	phase = PHASE_ERASE;
 }
 
+bool ICE40FlashExperiment::preparePattern(){
+
+	switch(phase)
+	{
+		case PHASE_ERASE:
+		{
+			if(test_flash.pollErase())
+			{
+				phase = PHASE_PROGRAM;
+			}
+			return false;
+		}
+		case PHASE_PROGRAM:
+		{
+			/* Queues as many pages as there are free slots, one page of the pattern at a time */
+			uint32_t page[MX25R6435F::PAGE_SIZE / sizeof(uint32_t)];
+			while(program_offset < SCAN_LENGTH && pattern_jobs.freeSlots())
+			{
+				ScanPattern::fill(page, SCAN_START + program_offset, sizeof(page) / sizeof(uint32_t), SCAN_SEED);
+				pattern_jobs.submitProgram(SCAN_START + program_offset, reinterpret_cast<uint8_t*>(page), sizeof(page));
+				program_offset += sizeof(page);
+			}
+			pattern_jobs.poll();
+
+			if(program_offset >= SCAN_LENGTH && pattern_jobs.isIdle())
+			{
+				/* Written last, a pattern that was cut off by a power loss is programmed again */
+				uint32_t marker[2] = {SCAN_MARKER_MAGIC, SCAN_SEED};
+				pattern_jobs.submitProgram(SCAN_MARKER_ADDRESS, reinterpret_cast<uint8_t*>(marker), sizeof(marker));
+				phase = PHASE_MARKER;
+			}
+			return false;
+		}
+		case PHASE_MARKER:
+		{
+			pattern_jobs.poll();
+			if(!pattern_jobs.isIdle())
+			{
+				return false;
+			}
+
+			LOGINFO("Scan pattern programmed\n");
+			return true;
+		}
+		default:
+		{
+			return true;
+		}
+	}
+}
+
+void ICE40FlashExperiment::recordPass(){
+
+	LOGINFO("Scan pass %d finished, %d mismatching bytes\n", scanner.getPass() - 1, scanner.getPassMismatches());
+
+	record.begin(RECORD_FLASH_SCAN, runningTime());
+	record.put32(scanner.getPass() - 1);
+	record.put32(scanner.getPassMismatches());
+	record.put32(classifier.getCount(FLIP_SEU));
+	record.put32(classifier.getCount(FLIP_STICKY));
+	record.put32(classifier.getCount(FLIP_CLUSTER));
+	record.put32(classifier.getDroppedEvents());
+	record.end();
+}
 
 void ICE40FlashExperiment::delayms(uint32_t timeout){
 	uint32_t delayTimeout = timer1.getTime()-(timeout*8000);
@@ -110,76 +191,17 @@ uint32_t ICE40FlashExperiment::runningTime(void){
 
 void ICE40FlashExperiment::readingSensors(){
     sensors.ice40_pac.refresh();       //refresh before reading values
-    hyperramAddUint32_t(runningTime());
-   	hyperramAddUint16_t(sensors.ice40_pac.getVoltageCH1Raw());
-    hyperramAddUint16_t(sensors.ice40_pac.getVoltageCH2Raw());
-    hyperramAddUint16_t(sensors.ice40_pac.getCurrentCH1Raw());
-    hyperramAddUint16_t(sensors.ice40_pac.getCurrentCH2Raw());
-    hyperramAddUint32_t(sensors.ice40_pac.getPowerCH1());
-    hyperramAddUint32_t(sensors.ice40_pac.getPowerCH2());
-	hyperramAddUint32_t(sensors.ice40_pac.getAccCurrentCH1());
-    hyperramAddUint32_t(sensors.ice40_pac.getAccCurrentCH2());
-    hyperramAddUint16_t(sensors.temp1.readTempRaw());
-    hyperramAddUint16_t(sensors.temp2.readTempRaw());
-    hyperramAddUint16_t(sensors.temp3.readTempRaw()); 
-}
-
-void ICE40FlashExperiment::hyperramAddUint8_t(uint8_t data){
-    memory.hyperram[ramPos] = data;
-    ramPos++;
-}
-
-void ICE40FlashExperiment::hyperramAddUint16_t(uint16_t data){
-    memory.hyperram[ramPos] = data >> 8;
-    ramPos++;
-	memory.hyperram[ramPos] = data & 0x00FF;
-    ramPos++;
-}
-
-void ICE40FlashExperiment::hyperramAddUint32_t(uint32_t data){
-	hyperramAddUint16_t(data >> 16);
-	hyperramAddUint16_t(data & 0x0000FFFF);
+    record.begin(RECORD_SENSORS, runningTime());
+   	record.put16(sensors.ice40_pac.getVoltageCH1Raw());
+    record.put16(sensors.ice40_pac.getVoltageCH2Raw());
+    record.put16(sensors.ice40_pac.getCurrentCH1Raw());
+    record.put16(sensors.ice40_pac.getCurrentCH2Raw());
+    record.put32(sensors.ice40_pac.getPowerCH1());
+    record.put32(sensors.ice40_pac.getPowerCH2());
+	record.put32(sensors.ice40_pac.getAccCurrentCH1());
+    record.put32(sensors.ice40_pac.getAccCurrentCH2());
+    record.put16(sensors.temp1.readTempRaw());
+    record.put16(sensors.temp2.readTempRaw());
+    record.put16(sensors.temp3.readTempRaw()); 
+    record.end();
 }
-
-void ICE40FlashExperiment::writeAddress(uint32_t address)
-{
-	/* Address space is 24 Bit */
-	ice40_spi.writeByte(address >> 16 & 0xFF);
-	ice40_spi.writeByte(address >> 8 & 0xFF);
-	ice40_spi.writeByte(address & 0xFF);
-	uint8_t Addr1 = address >> 16 & 0xFF;
-	uint8_t Addr2 = address >> 8 & 0xFF;
-	uint8_t Addr3 = address & 0xFF;
-
-	LOGINFO("Addr: %x %x %x \n", Addr1, Addr2, Addr3);
-}
-
-uint32_t ICE40FlashExperiment::readID()
-{
-	uint32_t result;
-
-	ice40_spi.assertCS();
-	ice40_spi.writeByte(0x9F);
-	result = ice40_spi.readByte(); 			// 0xC2
-	result |= ice40_spi.readByte() << 8;	// 0x28
-	result |= ice40_spi.readByte() << 16;	// 0x17
-	ice40_spi.releaseCS();
-	
-	return result;
-}
-
-void ICE40FlashExperiment::read(uint32_t address, uint32_t len)
-{
-	ice40_spi.assertCS();
-	ice40_spi.writeByte(0x0B);
-	writeAddress(address);
-
-	// Read the Data
-	for(uint32_t i = 0; i < len; i++)
-	{
-		flashBuff[i] = ice40_spi.readByte();
-	}
-
-	ice40_spi.releaseCS();
-
-} 
\ No newline at end of file
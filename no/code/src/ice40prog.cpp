@@ -2,25 +2,148 @@
 
 #if 1
 
-ICE40PROG::ICE40PROG(MX25R6435F& flash, SPI& ice40spi) : flash(flash), ice40spi(ice40spi)
+ICE40PROG::ICE40PROG(MemoryContext& memory, SPI& ice40spi) : slots(memory.flash), flash(memory.flash), ice40spi(ice40spi),
+staging(memory.arena.allocate("bitstream", RESERVED_SIZE))
 {
 	// GPIO Will always be low and only controlled via the OE Register
 	ice40_cp_out_write(0);
+
+	slots.load();
+}
+
+void ICE40PROG::sendConfig(uint32_t length)
+{
+	ice40spi.writeBurst(const_cast<uint8_t*>(staging->getData()), length);
 }
 
-void ICE40PROG::sendConfig()
+bool ICE40PROG::streamConfig(const BitstreamSlot& slot)
 {
-	for(uint32_t i = 0; i < ICE40_FILESIZE; i++)
+	uint8_t buffers[2][STREAM_CHUNK_SIZE];
+	uint8_t front = 0;
+	uint32_t crc = CRC32_INIT;
+
+	uint32_t front_len = MIN(STREAM_CHUNK_SIZE, slot.length);
+	flash.read(slot.offset, buffers[front], front_len);
+
+	for(uint32_t sent = 0; sent < slot.length; sent += front_len)
+	{
+		uint32_t next_offset = sent + front_len;
+		uint32_t back_len = MIN(STREAM_CHUNK_SIZE, slot.length - next_offset);
+
+		/* The next chunk is fetched while the current one is pushed out */
+		flash.readWhileWriting(slot.offset + next_offset, buffers[front ^ 1], back_len, ice40spi, buffers[front], front_len);
+		crc = crc32_update(crc, buffers[front], front_len);
+
+		front ^= 1;
+		front_len = back_len;
+	}
+
+	crc = crc32_final(crc);
+	if(!(slot.flags & SLOT_FLAG_NO_CRC) && crc != slot.crc)
+	{
+		LOGWARN("Bitstream is corrupt, CRC 0x%X instead of 0x%X", crc, slot.crc);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Reads the compressed image out of its slot into the CRC and pushes the decoded image to the ICE40
+ */
+struct SlotStreamPort
+{
+	MX25R6435F& flash;
+	SPI& target;
+	uint32_t base;
+	uint32_t crc;
+
+	void read(uint32_t offset, uint8_t* dst, uint32_t len)
+	{
+		flash.read(base + offset, dst, len);
+		crc = crc32_update(crc, dst, len);
+	}
+
+	void readWhileWriting(uint32_t offset, uint8_t* dst, uint32_t len, const uint8_t* src, uint32_t src_len)
+	{
+		flash.readWhileWriting(base + offset, dst, len, target, src, src_len);
+		crc = crc32_update(crc, dst, len);
+	}
+};
+
+bool ICE40PROG::streamCompressedConfig(const BitstreamSlot& slot)
+{
+	SlotStreamPort port = {flash, ice40spi, slot.offset, CRC32_INIT};
+	uint32_t read_end;
+
+	BitstreamStreamResult result = decoder.stream<STREAM_CHUNK_SIZE>(port, slot.length, read_end);
+	if(result == STREAM_BAD_HEADER)
+	{
+		LOGWARN("Compressed Bitstream has no valid header");
+		return false;
+	}
+	if(result == STREAM_TRUNCATED)
+	{
+		LOGWARN("Compressed Bitstream ends before the image is complete");
+		return false;
+	}
+
+	uint32_t crc = crc32_final(port.crc);
+	if(!(slot.flags & SLOT_FLAG_NO_CRC) && (read_end != slot.length || crc != slot.crc))
 	{
-		ice40spi.writeByte(reserved_ram[i]);
+		LOGWARN("Compressed Bitstream is corrupt, CRC 0x%X instead of 0x%X", crc, slot.crc);
+		return false;
 	}
+
+	return true;
 }
 
-void ICE40PROG::programm(uint32_t flash_start_address)
+bool ICE40PROG::programm(uint8_t slot_id, bool force, bool staged)
 {
+	const BitstreamSlot* slot = slots.get(slot_id);
+	if(!slot)
+	{
+		LOGWARN("No valid Bitstream in slot %d", slot_id);
+		return false;
+	}
+
+	if(!force && isLoaded(slot_id, *slot))
+	{
+		LOGINFO("ICE40 already holds the image of slot %d", slot_id);
+		return true;
+	}
+
 	LOGINFO("Started programming ice40");
-	LOGINFO("Reading bitfile from flash");
-	flash.read(flash_start_address, reserved_ram, ICE40_FILESIZE);
+	loaded = false;
+
+	/* The HyperRAM copy would be the compressed image */
+	if(slot->flags & SLOT_FLAG_COMPRESSED)
+	{
+		staged = false;
+	}
+
+	if(staged && slot->length > staging->getSize())
+	{
+		LOGWARN("Bitstream in slot %d doesnt fit into the HyperRAM, streaming it", slot_id);
+		staged = false;
+	}
+
+	if(staged)
+	{
+		LOGINFO("Reading bitfile version %d from flash", slot->version);
+		flash.read(slot->offset, staging->getData(), slot->length);
+
+		/* Dont even start the configuration with a corrupt image */
+		if(!(slot->flags & SLOT_FLAG_NO_CRC))
+		{
+			uint32_t crc = crc32(const_cast<uint8_t*>(staging->getData()), slot->length);
+			if(crc != slot->crc)
+			{
+				LOGWARN("Bitstream in slot %d is corrupt, CRC 0x%X instead of 0x%X", slot_id, crc, slot->crc);
+				return false;
+			}
+		}
+	}
 
 	LOGINFO("Start Resetting ICE40");
 	cresetLow();
@@ -35,8 +158,25 @@ void ICE40PROG::programm(uint32_t flash_start_address)
 
 	LOGINFO("Starting Image Sending");
 	// Send the Configuration data
-	sendConfig();
+	bool image_valid = true;
+	if(staged)
+	{
+		sendConfig(slot->length);
+	}
+	else
+	{
+		LOGINFO("Streaming bitfile version %d from flash", slot->version);
+		image_valid = (slot->flags & SLOT_FLAG_COMPRESSED) ? streamCompressedConfig(*slot) : streamConfig(*slot);
+	}
 	ice40spi.releaseCS();
+
+	/* A corrupt streamed image is only noticed at the end, keep the ICE40 in reset instead of waiting for CDONE */
+	if(!image_valid)
+	{
+		cresetLow();
+		return false;
+	}
+
 	sendDummyBytes(16);
 	LOGINFO("Done Image Sending");
 	
@@ -47,16 +187,21 @@ void ICE40PROG::programm(uint32_t flash_start_address)
 	do
 	{
 		cdone = cdoneRead();
-	} while (!cdone && timer0.passed(start) > (100 * MILLISECOND));
+	} while (!cdone && timer0.passed(start) < (100 * MILLISECOND));
 
 	if(cdone)
 	{
 		LOGINFO("DONE");
+		loaded = true;
+		loaded_slot = slot_id;
+		loaded_crc = slot->crc;
 	}
 	else
 	{
 		LOGINFO("FAIL");
-  }
+	}
+
+	return cdone;
 }
 
 void ICE40PROG::sendDummyBytes(uint32_t bytes)
@@ -82,5 +227,11 @@ bool ICE40PROG::cdoneRead()
 	return ice40_cd_in_read();
 }
 
+bool ICE40PROG::isLoaded(uint8_t slot_id, const BitstreamSlot& slot)
+{
+	/* CDONE drops if the ICE40 lost its configuration, e.g. after a power cycle */
+	return loaded && loaded_slot == slot_id && !(slot.flags & SLOT_FLAG_NO_CRC) && loaded_crc == slot.crc && cdoneRead();
+}
+
 
 #endif
\ No newline at end of file
@@ -1,3 +1,4 @@
+#define LOG_MODULE LOG_MODULE_ISFD
 #include "isfdExperiment.h"
 
 
@@ -52,19 +53,14 @@ bool ISFDExperiment::init(){
 	gpioWrite(RESET_PIN,GPIO_HIGH);
 
 	/* ICE40 Programming (ring oscillator: ice40_io_vcore_0 & ice40_io_vcore_1)*/
-	SPI ice40_spi(SPIDevice::ICE40);
-	ice40_spi.init(1, 0);
-	ICE40PROG ice40prog(memory.flash, ice40_spi);
-	ice40prog.programm(USERSPACE_OFFSET+104090);
+	programmer.programm(SLOT_ISFD);
 	delayms(10);
 	sensors.enableICE40OSC(false);
 
 	//Logging header
-	hyperramAddUint8_t('E');
-	hyperramAddUint8_t('X');
-	hyperramAddUint8_t('P');
-	hyperramAddUint8_t(EXPERIMENT_ID);
-	hyperramAddUint8_t('#');
+	record.begin(RECORD_EXPERIMENT_START, runningTime());
+	record.put8(EXPERIMENT_ID);
+	record.end();
 
 
 	/*First Log time=0*/
@@ -103,13 +99,11 @@ ExperimentState ISFDExperiment::run(){
 
 
     if (expRunNumber >= TOTAL_EXP_RUN) {
-        hyperramAddUint16_t(ramPos);
-		hyperramAddUint32_t(runningTime());
-		hyperramAddUint8_t('d');
-		hyperramAddUint8_t('o');
-		hyperramAddUint8_t('n');
-		hyperramAddUint8_t('e');
-		LOGINFO("Experiment %u finished! time=%lu ram=%lu", EXPERIMENT_ID, runningTime(), ramPos);
+        uint32_t recorded = record.getUsed();
+		record.begin(RECORD_EXPERIMENT_END, runningTime());
+		record.put32(recorded);
+		record.end();
+		LOGINFO("Experiment %u finished! time=%lu ram=%lu", EXPERIMENT_ID, runningTime(), record.getUsed());
 		// for (int i = ramPos; i > ramPos-34; i--)
 		// {
 		// 	LOGINFO("hyperram data: %lu -> %x\n", i, memory.hyperram[i]);
@@ -167,18 +161,20 @@ bool ISFDExperiment::makeTest(){
 	startTest();
     flagCheck(currentTestCase,1);
     
-	hyperramAddUint16_t(serialRead(currentTestCase, 9)); 
+	uint16_t result = serialRead(currentTestCase, 9);
 	flagCheck(currentTestCase,2);
     
-	hyperramAddUint8_t(tcInternalFlag[currentTestCase]);
+	uint8_t flags = tcInternalFlag[currentTestCase];
+	record.begin(RECORD_ISFD_TEST, runningTime());
+	record.put16(currentTestCase);
+	record.put16(result);
+	record.put8(flags);
+	record.end();
     
 	currentTestCase++;
 	delayms(5);
 
-	LOGINFO("ResultMSB ResultLSB TCFlugs: %x %x %x\n", memory.hyperram[ramPos], memory.hyperram[ramPos-1], memory.hyperram[ramPos-2]);
-
-	//add sperator;
-	hyperramAddUint8_t('#');
+	LOGINFO("ResultMSB ResultLSB TCFlugs: %x %x %x\n", result >> 8, result & 0xFF, flags);
 
 	// if(data==0 or data==0xFFFFF){
 	// 	return true;
@@ -288,34 +284,18 @@ uint32_t ISFDExperiment::runningTime(void){
 
 void ISFDExperiment::readingSensors(){
     sensors.ice40_pac.refresh();       //refresh before reading values
-    hyperramAddUint32_t(runningTime());
-   	hyperramAddUint16_t(sensors.ice40_pac.getVoltageCH1Raw());
-    hyperramAddUint16_t(sensors.ice40_pac.getVoltageCH2Raw());
-    hyperramAddUint16_t(sensors.ice40_pac.getCurrentCH1Raw());
-    hyperramAddUint16_t(sensors.ice40_pac.getCurrentCH2Raw());
-    hyperramAddUint32_t(sensors.ice40_pac.getPowerCH1());
-    hyperramAddUint32_t(sensors.ice40_pac.getPowerCH2());
-	hyperramAddUint32_t(sensors.ice40_pac.getAccCurrentCH1());
-    hyperramAddUint32_t(sensors.ice40_pac.getAccCurrentCH2());
-    hyperramAddUint16_t(sensors.temp1.readTempRaw());
-    hyperramAddUint16_t(sensors.temp2.readTempRaw());
-    hyperramAddUint16_t(sensors.temp3.readTempRaw());
-}
-
-void ISFDExperiment::hyperramAddUint8_t(uint8_t data){
-    memory.hyperram[ramPos] = data;
-    ramPos++;
-}
-
-void ISFDExperiment::hyperramAddUint16_t(uint16_t data){
-    memory.hyperram[ramPos] = data >> 8;
-    ramPos++;
-	memory.hyperram[ramPos] = data & 0x00FF;
-    ramPos++;
-}
-
-void ISFDExperiment::hyperramAddUint32_t(uint32_t data){
-	hyperramAddUint16_t(data >> 16);
-	hyperramAddUint16_t(data & 0x0000FFFF);
+    record.begin(RECORD_SENSORS, runningTime());
+   	record.put16(sensors.ice40_pac.getVoltageCH1Raw());
+    record.put16(sensors.ice40_pac.getVoltageCH2Raw());
+    record.put16(sensors.ice40_pac.getCurrentCH1Raw());
+    record.put16(sensors.ice40_pac.getCurrentCH2Raw());
+    record.put32(sensors.ice40_pac.getPowerCH1());
+    record.put32(sensors.ice40_pac.getPowerCH2());
+	record.put32(sensors.ice40_pac.getAccCurrentCH1());
+    record.put32(sensors.ice40_pac.getAccCurrentCH2());
+    record.put16(sensors.temp1.readTempRaw());
+    record.put16(sensors.temp2.readTempRaw());
+    record.put16(sensors.temp3.readTempRaw());
+    record.end();
 }
 
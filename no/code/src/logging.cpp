@@ -1,7 +1,50 @@
 #include "logging.h"
+#include "serial.h"
+#include <stdarg.h>
 
 Serial* serial;
 
+uint8_t log_levels[LOG_MODULE_COUNT] = {LOG_LEVEL, LOG_LEVEL, LOG_LEVEL, LOG_LEVEL, LOG_LEVEL, LOG_LEVEL, LOG_LEVEL, LOG_LEVEL};
+static_assert(LOG_MODULE_COUNT == 8, "every module has to start at LOG_LEVEL");
+
+#if LOG_BINARY
+/* Binary log records, log_head is only moved by logPush(), log_tail only by logPoll() */
+static uint8_t log_ring[LOG_RING_SIZE];
+static uint32_t log_head = 0;
+static uint32_t log_tail = 0;
+static uint32_t log_dropped = 0;
+
+static const char log_dropped_format[] __attribute__((section(".logfmt"), used)) =
+    "WARN\0" __FILE__ ":" LOG_STRINGIFY(__LINE__) "\0%lu log records dropped";
+
+static uint32_t logRingFree()
+{
+    return (log_tail - log_head - 1) & (LOG_RING_SIZE - 1);
+}
+
+static void logRingWrite(const uint8_t* record, uint32_t length)
+{
+    for(uint32_t i = 0; i < length; i++)
+    {
+        log_ring[log_head] = record[i];
+        log_head = (log_head + 1) & (LOG_RING_SIZE - 1);
+    }
+}
+
+static void logReportDropped()
+{
+    /* Tells the host about the gap before the next record */
+    if(log_dropped && logRingFree() >= LOG_RECORD_HEADER + 4)
+    {
+        uint32_t id = (uintptr_t)log_dropped_format;
+        uint8_t dropped[LOG_RECORD_HEADER + 4] = {LOG_SYNC, (uint8_t)id, (uint8_t)(id >> 8), 4};
+        memcpy(&dropped[LOG_RECORD_HEADER], &log_dropped, 4);
+        logRingWrite(dropped, sizeof(dropped));
+        log_dropped = 0;
+    }
+}
+#endif
+
 void setupLogging(Serial* new_serial)
 {
     if(new_serial)
@@ -10,6 +53,30 @@ void setupLogging(Serial* new_serial)
     }
 }
 
+bool logSetLevel(uint8_t module, uint8_t level)
+{
+    if(level > LOG_LEVEL_INFO || (module >= LOG_MODULE_COUNT && module != LOG_MODULE_ALL))
+    {
+        return false;
+    }
+
+    /* Levels above LOG_LEVEL are not compiled in anyway */
+    if(level > LOG_LEVEL)
+    {
+        level = LOG_LEVEL;
+    }
+
+    for(uint8_t i = 0; i < LOG_MODULE_COUNT; i++)
+    {
+        if(module == LOG_MODULE_ALL || module == i)
+        {
+            log_levels[i] = level;
+        }
+    }
+
+    return true;
+}
+
 void log(const char* prefix, const char* file, const char* function, uint32_t line, const char* format, ...)
 {
     if(serial)
@@ -42,3 +109,70 @@ void print(const char* format, ...)
         serial->writeString(buffer);
     }
 }
+
+#if LOG_BINARY
+void logPush(uint8_t* record, uint32_t length)
+{
+    /* Logs may come from an interrupt as well */
+    uint32_t ie = irq_getie();
+    irq_setie(0);
+
+    logReportDropped();
+
+    /* While the gap is not reported yet, later records would hide it */
+    if(!log_dropped && logRingFree() >= length)
+    {
+        logRingWrite(record, length);
+    }
+    else
+    {
+        log_dropped++;
+    }
+
+    irq_setie(ie);
+
+    logPoll();
+}
+
+void logPoll()
+{
+    if(!serial)
+    {
+        return;
+    }
+
+    uint32_t ie = irq_getie();
+    irq_setie(0);
+
+    logReportDropped();
+
+    /* Only whole records are handed over, so nothing else written to the UART can end up inside one */
+    while(log_tail != log_head)
+    {
+        uint32_t length = LOG_RECORD_HEADER + log_ring[(log_tail + 3) & (LOG_RING_SIZE - 1)];
+        if(serial->txFree() < length)
+        {
+            break;
+        }
+
+        uint32_t first = LOG_RING_SIZE - log_tail;
+        if(first > length)
+        {
+            first = length;
+        }
+        serial->writeAsync(&log_ring[log_tail], first);
+        serial->writeAsync(log_ring, length - first);
+        log_tail = (log_tail + length) & (LOG_RING_SIZE - 1);
+    }
+
+    irq_setie(ie);
+}
+#else
+void logPush(uint8_t* record, uint32_t length)
+{
+}
+
+void logPoll()
+{
+}
+#endif
@@ -1,6 +1,7 @@
+#define LOG_MODULE LOG_MODULE_MEMORY
 #include "memorycontext.h"
 
-MemoryContext::MemoryContext(): spi(SPI(SPIDevice::FLASH)), flash(MX25R6435F(spi))
+MemoryContext::MemoryContext(): spi(SPI(SPIDevice::FLASH)), flash(MX25R6435F(spi)), flash_jobs(flash), journal(flash, flash_jobs), arena((uint8_t*)HYPER_RAM_BASE, HYPER_RAM_SIZE)
 {
 }
 
@@ -11,6 +12,11 @@ void MemoryContext::setupMemories()
 	flash.reset();
 	uint32_t id = flash.readID();
 	LOGINFO("Flash ID has been read: 0x%x", id);
+
+#if FLASH_BENCHMARK
+	Timer timer0(TimerID::TIMER0);
+	flash.measureReadThroughput(timer0, USERSPACE_OFFSET, 1024);
+#endif
 	//if(!flash.testFlash())
 	{
 	//	LOGWARN("Flash isnt properly initialized");
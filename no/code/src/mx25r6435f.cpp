@@ -1,5 +1,67 @@
+#define LOG_MODULE LOG_MODULE_MEMORY
 #include "mx25r6435f.h"
 
+ErasePlan::ErasePlan() : cursor(0), end(0)
+{
+}
+
+ErasePlan::ErasePlan(uint32_t address, uint32_t len)
+{
+	/* Widen to whole Sectors */
+	cursor = address & ~(SECTOR_SIZE - 1);
+	end = len ? (address + len + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1) : cursor;
+}
+
+EraseStep ErasePlan::stepAt(uint32_t cursor, uint32_t end)
+{
+	EraseStep step;
+	step.address = cursor;
+
+	/* Biggest aligned Block that still fits into the rest of the range */
+	if(!(cursor & (BLOCK64K_SIZE - 1)) && end - cursor >= BLOCK64K_SIZE)
+	{
+		step.size = BLOCK64K_SIZE;
+		step.opcode = MX25R6435F::BLOCK_ERASE_64K;
+	}
+	else if(!(cursor & (BLOCK32K_SIZE - 1)) && end - cursor >= BLOCK32K_SIZE)
+	{
+		step.size = BLOCK32K_SIZE;
+		step.opcode = MX25R6435F::BLOCK_ERASE_32K;
+	}
+	else
+	{
+		step.size = SECTOR_SIZE;
+		step.opcode = MX25R6435F::SECTOR_ERASE;
+	}
+
+	return step;
+}
+
+bool ErasePlan::next(EraseStep& step)
+{
+	if(done())
+	{
+		return false;
+	}
+
+	step = stepAt(cursor, end);
+	cursor += step.size;
+
+	return true;
+}
+
+uint32_t ErasePlan::countSteps() const
+{
+	uint32_t steps = 0;
+
+	for(uint32_t position = cursor; position < end; position += stepAt(position, end).size)
+	{
+		steps++;
+	}
+
+	return steps;
+}
+
 MX25R6435F::MX25R6435F(SPI& spi) : flash_spi(spi)
 {
 
@@ -20,33 +82,101 @@ uint8_t MX25R6435F::readByte(uint32_t address)
 
 void MX25R6435F::read(uint32_t address, uint8_t* dst, uint32_t len)
 {
-	flash_spi.assertCS();
-	flash_spi.writeByte(READ);
-	writeAddress(address);
+	/* Reads are not possible while an erase or program is running */
+	bool suspended = suspendErase();
+	if(command_pending) while(isBusy());
 
-	// Read the Data
-	for(uint32_t i = 0; i < len; i++)
+	startFastRead(address);
+	flash_spi.readBurst(dst, len);
+	flash_spi.releaseCS();
+
+	if(suspended) resumeErase();
+} 
+
+void MX25R6435F::read(uint32_t address, volatile uint8_t* dst, uint32_t len)
+{
+	bool suspended = suspendErase();
+	if(command_pending) while(isBusy());
+
+	startFastRead(address);
+	flash_spi.readBurst(dst, len);
+	flash_spi.releaseCS();
+
+	if(suspended) resumeErase();
+} 
+
+void MX25R6435F::readWhileWriting(uint32_t address, uint8_t* dst, uint32_t len, SPI& target, const uint8_t* src, uint32_t src_len)
+{
+	if(!len)
 	{
-		dst[i] = flash_spi.readByte();
+		target.writeBurst(src, src_len);
+		return;
 	}
 
+	bool suspended = suspendErase();
+	if(command_pending) while(isBusy());
+
+	startFastRead(address);
+	flash_spi.readBurstWhileWriting(dst, len, target, src, src_len);
 	flash_spi.releaseCS();
-} 
 
-void MX25R6435F::read(uint32_t address, volatile uint8_t* dst, uint32_t len)
+	if(suspended) resumeErase();
+}
+
+void MX25R6435F::beginRead(uint32_t address)
+{
+	read_suspended = suspendErase();
+	if(command_pending) while(isBusy());
+
+	startFastRead(address);
+	flash_spi.beginReadBurst();
+}
+
+void MX25R6435F::endRead()
+{
+	flash_spi.releaseCS();
+
+	if(read_suspended) resumeErase();
+	read_suspended = false;
+}
+
+void MX25R6435F::startFastRead(uint32_t address)
 {
 	flash_spi.assertCS();
-	flash_spi.writeByte(READ);
+	flash_spi.writeByte(FAST_READ);
 	writeAddress(address);
+	/* 8 Dummy Cycles */
+	flash_spi.writeByte(NOP);
+}
 
-	// Read the Data
+void MX25R6435F::measureReadThroughput(Timer& timer, uint32_t address, uint32_t len)
+{
+	uint8_t buf[MEASURE_SIZE];
+	len = MIN(len, MEASURE_SIZE);
+
+	/* Plain Read, one CSR write and busy wait per byte */
+	uint32_t start = timer.getTime();
+	flash_spi.assertCS();
+	flash_spi.writeByte(READ);
+	writeAddress(address);
 	for(uint32_t i = 0; i < len; i++)
 	{
-		dst[i] = flash_spi.readByte();
+		buf[i] = flash_spi.readByte();
 	}
-
 	flash_spi.releaseCS();
-} 
+	uint32_t read_ticks = timer.passed(start);
+
+	/* Fast Read with a pipelined burst */
+	start = timer.getTime();
+	read(address, buf, len);
+	uint32_t fast_read_ticks = timer.passed(start);
+
+	uint32_t read_rate = read_ticks ? (uint64_t)len * SECOND / read_ticks : 0;
+	uint32_t fast_read_rate = fast_read_ticks ? (uint64_t)len * SECOND / fast_read_ticks : 0;
+
+	LOGTEST("Read: %d bytes in %d ticks, %d bytes/s", len, read_ticks, read_rate);
+	LOGTEST("Fast Read burst: %d bytes in %d ticks, %d bytes/s", len, fast_read_ticks, fast_read_rate);
+}
 
 uint32_t MX25R6435F::readID()
 {
@@ -72,6 +202,8 @@ void MX25R6435F::reset()
 
 void MX25R6435F::writeByte(uint32_t address, uint8_t byte)
 {
+	/* Dont interfere with a running erase plan */
+	finishErase();
 	while(writeInProgress());
 	writeEnable();
 
@@ -82,25 +214,42 @@ void MX25R6435F::writeByte(uint32_t address, uint8_t byte)
 	flash_spi.releaseCS();
 
 	writeDisable();
+
+	command_pending = true;
 }
 
 void MX25R6435F::naiveWrite(uint32_t address, const uint8_t* data, uint32_t len)
 {
+	finishErase();
 	while(writeInProgress());
+
+	startPageProgram(address, data, len);
+}
+
+void MX25R6435F::startPageProgram(uint32_t address, const uint8_t* data, uint32_t len)
+{
 	writeEnable();
 
 	flash_spi.assertCS();
 	flash_spi.writeByte(WRITE);
 	writeAddress(address);
+	flash_spi.writeBurst(data, len);
+	flash_spi.releaseCS();
 
-	// Write the Data
-	for(uint32_t i = 0; i < len; i++)
+	writeDisable();
+
+	command_pending = true;
+}
+
+bool MX25R6435F::isBusy()
+{
+	if(writeInProgress())
 	{
-		flash_spi.writeByte(data[i]);
+		return true;
 	}
-	flash_spi.releaseCS();
 
-	writeDisable();
+	command_pending = false;
+	return false;
 }
 
 void MX25R6435F::write(uint32_t address, const uint8_t* data, uint32_t len)
@@ -121,6 +270,7 @@ void MX25R6435F::write(uint32_t address, const uint8_t* data, uint32_t len)
 
 void MX25R6435F::eraseSector(uint32_t address)
 {
+	finishErase();
 	while(writeInProgress());
 	writeEnable();
 
@@ -130,10 +280,13 @@ void MX25R6435F::eraseSector(uint32_t address)
 	flash_spi.releaseCS();
 
 	writeDisable();
+
+	command_pending = true;
 }
 
 void MX25R6435F::eraseBlock32k(uint32_t address)
 {
+	finishErase();
 	while(writeInProgress());
 	writeEnable();
 
@@ -143,10 +296,13 @@ void MX25R6435F::eraseBlock32k(uint32_t address)
 	flash_spi.releaseCS();
 
 	writeDisable();
+
+	command_pending = true;
 }
 
 void MX25R6435F::eraseBlock64K(uint32_t address)
 {
+	finishErase();
 	while(writeInProgress());
 	writeEnable();
 
@@ -156,6 +312,102 @@ void MX25R6435F::eraseBlock64K(uint32_t address)
 	flash_spi.releaseCS();
 
 	writeDisable();
+
+	command_pending = true;
+}
+
+void MX25R6435F::eraseRange(uint32_t address, uint32_t len)
+{
+	beginErase(address, len);
+	finishErase();
+}
+
+void MX25R6435F::beginErase(uint32_t address, uint32_t len)
+{
+	/* A plan that is still running gets finished first */
+	finishErase();
+
+	erase_plan = ErasePlan(address, len);
+	erase_active = !erase_plan.done();
+
+	LOGINFO("Erasing %d bytes at %d with %d commands", len, address, erase_plan.countSteps());
+}
+
+bool MX25R6435F::pollErase()
+{
+	if(!erase_active)
+	{
+		return true;
+	}
+
+	if(erase_suspended || writeInProgress())
+	{
+		return false;
+	}
+
+	EraseStep step;
+	if(erase_plan.next(step))
+	{
+		startErase(step);
+		return false;
+	}
+
+	erase_active = false;
+	return true;
+}
+
+void MX25R6435F::finishErase()
+{
+	resumeErase();
+	while(!pollErase());
+}
+
+bool MX25R6435F::suspendErase()
+{
+	if(!erase_active || erase_suspended || !writeInProgress())
+	{
+		return false;
+	}
+
+	flash_spi.assertCS();
+	flash_spi.writeByte(ERASE_SUSPEND);
+	flash_spi.releaseCS();
+
+	/* Busy till the suspend latency has passed */
+	while(writeInProgress());
+
+	/* The erase may have finished right before the suspend arrived */
+	if(!(readSecurity() & ERASE_SUSPENDED_BIT))
+	{
+		return false;
+	}
+
+	erase_suspended = true;
+	return true;
+}
+
+void MX25R6435F::resumeErase()
+{
+	if(!erase_suspended)
+	{
+		return;
+	}
+
+	flash_spi.assertCS();
+	flash_spi.writeByte(ERASE_RESUME);
+	flash_spi.releaseCS();
+
+	erase_suspended = false;
+}
+
+void MX25R6435F::startErase(const EraseStep& step)
+{
+	writeEnable();
+
+	flash_spi.assertCS();
+	flash_spi.writeByte(step.opcode);
+	writeAddress(step.address);
+	flash_spi.releaseCS();
 }
 
 void MX25R6435F::writeEnable()
@@ -192,6 +444,18 @@ uint8_t MX25R6435F::readStatus()
 	return result;
 }
 
+uint8_t MX25R6435F::readSecurity()
+{
+	uint8_t result;
+
+	flash_spi.assertCS();
+	flash_spi.writeByte(READ_SECURITY);
+	result = flash_spi.readByte();
+	flash_spi.releaseCS();
+
+	return result;
+}
+
 #include "delay.h"
 
 bool MX25R6435F::writeInProgress()
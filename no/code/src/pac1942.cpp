@@ -1,3 +1,4 @@
+#define LOG_MODULE LOG_MODULE_SENSORS
 #include "pac1942.h"
 #include "logging.h"
 
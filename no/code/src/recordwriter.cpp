@@ -0,0 +1,104 @@
+#define LOG_MODULE LOG_MODULE_MEMORY
+#include "recordwriter.h"
+#include <string.h>
+
+bool RecordWriter::begin(RecordType type, uint32_t timestamp)
+{
+	if(schema)
+	{
+		end();
+	}
+
+	schema = findSchema(type);
+	if(!schema)
+	{
+		LOGWARN("No schema for record type %d", type);
+		return false;
+	}
+
+	crc = CRC16_INIT;
+	written = 0;
+
+	uint8_t header[RECORD_HEADER_SIZE] =
+	{
+		type,
+		RECORD_SCHEMA_VERSION,
+		(uint8_t)(schema->length >> 8), (uint8_t)(schema->length & 0xFF),
+		(uint8_t)(timestamp >> 24), (uint8_t)(timestamp >> 16), (uint8_t)(timestamp >> 8), (uint8_t)(timestamp & 0xFF),
+	};
+
+	crc = crc16_ccitt_update(crc, header, RECORD_HEADER_SIZE);
+	writer.putBytes(header, RECORD_HEADER_SIZE);
+
+	return true;
+}
+
+void RecordWriter::add(uint8_t byte)
+{
+	if(!schema || written >= schema->length)
+	{
+		return;
+	}
+
+	crc = crc16_ccitt_update(crc, &byte, 1);
+	writer.put8(byte);
+	written++;
+}
+
+void RecordWriter::put8(uint8_t value)
+{
+	add(value);
+}
+
+void RecordWriter::put16(uint16_t value)
+{
+	add(value >> 8);
+	add(value & 0xFF);
+}
+
+void RecordWriter::put32(uint32_t value)
+{
+	put16(value >> 16);
+	put16(value & 0xFFFF);
+}
+
+void RecordWriter::putFloat(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	put32(bits);
+}
+
+void RecordWriter::putBytes(const uint8_t* src, uint32_t len)
+{
+	for(uint32_t i = 0; i < len; i++)
+	{
+		add(src[i]);
+	}
+}
+
+void RecordWriter::end()
+{
+	if(!schema)
+	{
+		return;
+	}
+
+	if(written != schema->length)
+	{
+		LOGWARN("Record %s has %d of %d payload bytes", schema->name, written, schema->length);
+		while(written < schema->length)
+		{
+			add(0);
+		}
+	}
+
+	writer.put16(crc);
+	schema = nullptr;
+}
+
+void RecordWriter::reset()
+{
+	schema = nullptr;
+	writer.reset();
+}
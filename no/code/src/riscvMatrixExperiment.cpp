@@ -8,6 +8,7 @@
  *
  */
 
+#define LOG_MODULE LOG_MODULE_RISCV
 #include "riscvMatrixExperiment.h"
 #include "serial.h"
 
@@ -29,7 +30,7 @@ bool RiscvMatrixExperiment::init()
     error = false;
     currentTestID = 0;
     timeoutTime = 0;
-    ram_counter = 0;
+    record.reset();
     memset(errorCounter,0,sizeof(errorCounter));
 
     uart_flags = {
@@ -49,9 +50,6 @@ bool RiscvMatrixExperiment::init()
     timer1.start();    
 
     /* ICE40 Programming ()*/
-    SPI ice40_spi(SPIDevice::ICE40);
-    ice40_spi.init(1, 0);
-
     sensors.dac.setOutputVoltagerange(MAX_2V5);
     sensors.dac.setVoltage(1200);
     sensors.enableICE40OSC(true);
@@ -59,18 +57,18 @@ bool RiscvMatrixExperiment::init()
     sensors.enableICE40VIO(true);
 
     //programmer.programm(USERSPACE_OFFSET + EXPERIMENT_ID * CONFIG_SIZE);
-    programmer.programm(CONFIG_OFFSETS::Exp1);
+    programmer.programm(SLOT_EXP1);
     // Firmware zweimal im Flash ablegen, falls eins kaputt geht???
 
     /* Save Experiment ID to RAM */
 
-    memory.hyperram[ram_counter] = EXPERIMENT_ID;
-    ram_counter++;
+    record.begin(RECORD_EXPERIMENT_START, runningTime());
+    record.put8(EXPERIMENT_ID);
+    record.end();
 
     //flush buffer
-    while(!iceUART.isEmpty()){
-        iceUART.readNonBlocking(); 
-    }    
+    uint8_t discard;
+    while(iceUART.read(discard, 0)){}
 
     LOGINFO("RiscvMatrixExperiment joins the party!\n");
     return true;
@@ -181,9 +179,10 @@ ExperimentState RiscvMatrixExperiment::run()
         writeDataRAM();
         if(currentTestID == ((sizeof(matrixVoltageSteps) / sizeof(matrixVoltageSteps[0]))*TEST_PER_VOLTAGE)-1 && cleanUp()){
             LOGINFO("DBX: Max TestID reached, printing RAM now:\n");
-            LOGINFO("ram_counter=%lu",ram_counter);
-            for(uint16_t pos=0; pos<ram_counter; pos++){
-                LOGINFO("%u", memory.hyperram[pos]);
+            HyperRamRegion* ram = getResults();
+            LOGINFO("ram_counter=%lu",ram->getUsed());
+            for(uint32_t pos=0; pos<ram->getUsed(); pos++){
+                LOGINFO("%u", ram->getData()[pos]);
             }           
             
             return ExperimentState::TEST_FINISHED;
@@ -210,7 +209,7 @@ ExperimentState RiscvMatrixExperiment::run()
         //reflash Firmware
         //programmer.programm(USERSPACE_OFFSET + EXPERIMENT_ID*CONFIG_SIZE);
         sensors.dac.setVoltage(1200);
-        programmer.programm(CONFIG_OFFSETS::Exp1);
+        programmer.programm(SLOT_EXP1);
         return ExperimentState::STILL_RUNNING;
         //Start another test without increase in TestID
     }
@@ -290,42 +289,42 @@ void RiscvMatrixExperiment::readEnvironment(float* data){
 
 }
 
+uint32_t RiscvMatrixExperiment::runningTime(){
+    return 0xFFFFFFFF - timer1.getTime(); // Down counter
+}
+
+static_assert(payloadLength(RISCV_MATRIX_FIELDS) == 1 + 2 * MATRIX_SIZE * 4 + 2 * SENSORREADINGS_SIZE * 4 + ERROR_SIZE,
+    "RISCV_MATRIX_FIELDS doesnt match the experiment");
+
 void RiscvMatrixExperiment::writeDataRAM(){
 
     // Write Test ID
-    memory.hyperram[ram_counter] = currentTestID;
+    record.begin(RECORD_RISCV_MATRIX, runningTime());
+    record.put8(currentTestID);
     
     // Write first matrix
     for (int i = 0; i < MATRIX_SIZE; i++) {
-        memory.hyperram[ram_counter] = HORIZONTALSUM[i];
-        ram_counter++;
+        record.put32(HORIZONTALSUM[i]);
     }
     
     // Write second matrix
      for (int i = 0; i < MATRIX_SIZE; i++) {
-        memory.hyperram[ram_counter] = VERTICALSUM[i];
-        ram_counter++;
+        record.put32(VERTICALSUM[i]);
     }
     
     // Write pre Test sensor readings
     for (int i = 0; i < SENSORREADINGS_SIZE; i++) {
-        memory.hyperram[ram_counter] = preTestReadings[i];
-        ram_counter++;
+        record.putFloat(preTestReadings[i]);
     }
 
     // Write after Test sensor readings
     for (int i = 0; i < SENSORREADINGS_SIZE; i++) {
-        memory.hyperram[ram_counter] = afterTestReadings[i];
-        ram_counter++;
+        record.putFloat(afterTestReadings[i]);
     }
 
-    for (int i = 0; i < ERROR_SIZE; i++) {
-        memory.hyperram[ram_counter] = errorCounter[i];
-        ram_counter++;
-    }
+    record.putBytes(errorCounter, ERROR_SIZE);
     
-    // Add newline (0x0A) at the end
-    memory.hyperram[ram_counter] = 0x0A;
+    record.end();
     
 }
 
@@ -387,14 +386,16 @@ bool RiscvMatrixExperiment::checkCRC8(uint8_t* data, uint8_t length) {
     }
 }
 
-uint8_t RiscvMatrixExperiment::validateBuffer(uint8_t *buffer, uint8_t length, uint8_t max_retries) {
+int8_t RiscvMatrixExperiment::validateBuffer(uint8_t *buffer, uint8_t length, uint8_t max_retries) {
     uint8_t retryCount = 0;
     while (checkCRC8(buffer, length) != true) {
         // Shift buffer content
         for (int i = 0; i < length - 1; i++) {
             buffer[i] = buffer[i + 1];
         }
-        buffer[length - 1] = iceUART.readNonBlocking();                             // Read the next byte
+        if (!iceUART.read(buffer[length - 1], UART_BYTE_TIMEOUT)) {    // Read the next byte
+            return -1;                                              // Nothing more is coming
+        }
         retryCount++;
         if (retryCount >= max_retries) {
             return -1;                                              // Return failure
@@ -444,7 +445,7 @@ void RiscvMatrixExperiment::sendUART(UART_Command *command, uint8_t *data) {
 uint32_t RiscvMatrixExperiment::receiveUART() {
     uint8_t header = 0;
     uint8_t uartDataBuffer[BUFFER_SIZE] = {0};
-    header = iceUART.readNonBlocking(); 
+    iceUART.read(header, UART_BYTE_TIMEOUT);
     while(  header != uart_flags.start_test.value &&
     	    header != uart_flags.test_finish.value &&
             header != uart_flags.ack.value && 
@@ -455,9 +456,7 @@ uint32_t RiscvMatrixExperiment::receiveUART() {
             header != uart_flags.error.value &&
             timeout() != true
             ){
-            if(!iceUART.isEmpty()){
-                header = iceUART.readNonBlocking();                                        // wait for a valid header
-            }
+            iceUART.read(header, UART_BYTE_TIMEOUT);                                   // wait for a valid header
     }
     switch (header) {
         //case UART_START_TEST:
@@ -467,7 +466,7 @@ uint32_t RiscvMatrixExperiment::receiveUART() {
         case UART_DATA_WRONG:
             uartDataBuffer[0] = header;
             for (int i = 1; i < 3; i++) {
-                uartDataBuffer[i] = iceUART.readNonBlocking(); 
+                iceUART.read(uartDataBuffer[i], UART_BYTE_TIMEOUT);
             }
             if (validateBuffer(uartDataBuffer, 3, UART_TIMEOUT_LIMIT5) < 0) {
                 logError(ERROR_UART);
@@ -481,7 +480,7 @@ uint32_t RiscvMatrixExperiment::receiveUART() {
              // Validate 6-byte frames
             uartDataBuffer[0] = header;
             for (int i = 1; i < 6; i++) {
-                uartDataBuffer[i] = iceUART.readNonBlocking(); 
+                iceUART.read(uartDataBuffer[i], UART_BYTE_TIMEOUT);
             }
             if (validateBuffer(uartDataBuffer, 6, UART_TIMEOUT_LIMIT7) < 0) {
                 logError(ERROR_UART);                  // Too many retries
@@ -0,0 +1,51 @@
+#include "scanpattern.h"
+
+void ScanPattern::fill(uint32_t* dst, uint32_t address, uint32_t words, uint32_t seed)
+{
+	for(uint32_t i = 0; i < words; i++)
+	{
+		dst[i] = word(address + (i << 2), seed);
+	}
+}
+
+uint32_t ScanPattern::compare(const uint32_t* data, uint32_t address, uint32_t words, uint32_t seed, uint32_t pass, ScanMismatchSink* sink)
+{
+	uint32_t mismatches = 0;
+
+	for(uint32_t i = 0; i < words; i++)
+	{
+		mismatches += compareWord(data[i], address + (i << 2), seed, pass, sink);
+	}
+
+	return mismatches;
+}
+
+uint32_t ScanPattern::reportWord(uint32_t data, uint32_t expected, uint32_t address, uint32_t pass, ScanMismatchSink* sink)
+{
+	uint32_t diff = data ^ expected;
+	uint32_t mismatches = 0;
+
+	for(uint32_t byte = 0; byte < 4; byte++)
+	{
+		uint8_t flipped = (diff >> (byte * 8)) & 0xFF;
+		if(!flipped)
+		{
+			continue;
+		}
+
+		mismatches++;
+
+		if(sink)
+		{
+			ScanMismatch mismatch;
+			mismatch.address = address + byte;
+			mismatch.pass = pass;
+			mismatch.expected = (expected >> (byte * 8)) & 0xFF;
+			mismatch.actual = (data >> (byte * 8)) & 0xFF;
+			mismatch.flipped = flipped;
+			sink->onMismatch(mismatch);
+		}
+	}
+
+	return mismatches;
+}
@@ -4,8 +4,9 @@
 
 uint32_t Serial::instance_mask = 0;
 Serial* Serial::interrupt_instances[CONFIG_CPU_INTERRUPTS] = {nullptr};
+Timer* Serial::deadline_timer = nullptr;
 
-Serial::Serial(UARTDevice device) : write_head(0), read_head(0)
+Serial::Serial(UARTDevice device, uint8_t* rx_buffer, uint32_t rx_size) : rx_buffer(rx_buffer), rx_mask(rx_size - 1)
 {
 	switch(device)
 	{
@@ -49,11 +50,36 @@ void Serial::uartIsr()
 		{
 			Serial* irq_source = interrupt_instances[irq];
 
-			irq_source->resetInterrupt();
-			irq_source->uart_buffer[irq_source->write_head] = csr_read_simple(irq_source->uart_base_addr + UART_RX_OFFSET);
-
-			/* Write head rolls over after reaching uart_buffer_size*/
-			irq_source->write_head = (irq_source->write_head + 1) & (UART_BUF_SIZE - 1);
+			uint32_t events = csr_read_simple(irq_source->uart_base_addr + UART_EV_PENDING_OFFSET);
+			csr_write_simple(events, irq_source->uart_base_addr + UART_EV_PENDING_OFFSET);
+
+			if(events & (1 << EV_RX))
+			{
+				uint8_t byte = csr_read_simple(irq_source->uart_base_addr + UART_RX_OFFSET);
+
+				/* Write head rolls over after reaching the buffer size, a full buffer drops the new byte instead */
+				uint32_t next = (irq_source->write_head + 1) & irq_source->rx_mask;
+				if(next == irq_source->read_head)
+				{
+					irq_source->rx_dropped++;
+					if(!irq_source->rx_full)
+					{
+						irq_source->rx_overruns++;
+						irq_source->rx_full = true;
+					}
+				}
+				else
+				{
+					irq_source->rx_buffer[irq_source->write_head] = byte;
+					irq_source->write_head = next;
+					irq_source->rx_full = false;
+				}
+			}
+
+			if(events & (1 << EV_TX))
+			{
+				irq_source->serviceTX();
+			}
 		}
 
 		irqs &= ~(1 << irq);
@@ -70,10 +96,13 @@ void Serial::initInterrupts()
 	instance_mask |= (1 << uart_interrupt);
 
 	/* Clear the Pending Interrupts */
-	csr_write_simple(uart_interrupt, uart_base_addr + UART_EV_PENDING_OFFSET);
+	resetInterrupt();
 
 	/* Enable Interrupts and Attach Function to it */
-	csr_write_simple(1 << EV_RX, uart_base_addr + UART_EV_ENABLE_OFFSET);
+	csr_write_simple((1 << EV_RX) | (1 << EV_TX), uart_base_addr + UART_EV_ENABLE_OFFSET);
+
+	/* Without a TX event in the gateware its enable bit doesnt exist, the bytes are sent polled then */
+	tx_interrupts = csr_read_simple(uart_base_addr + UART_EV_ENABLE_OFFSET) & (1 << EV_TX);
 	irq_attach(uart_interrupt, uartIsr);
 	irq_setmask(irq_getmask() | (1 << uart_interrupt));
 
@@ -87,18 +116,103 @@ void Serial::resetInterrupt()
 
 void Serial::write(uint8_t byte)
 {
-	csr_write_simple(byte, uart_base_addr + UART_TX_OFFSET);
-	csr_write_simple(1 << DIN_VLD_OFFSET, uart_base_addr + UART_CONTROL_OFFSET);
-
-	while(!(csr_read_simple(uart_base_addr + UART_STATUS_OFFSET) & (1 << DIN_RDY_OFFSET)));
+	write(&byte, 1);
 }
 
 void Serial::write(uint8_t *bytes, uint32_t length)
 {
+	while(length)
+	{
+		uint32_t written = writeAsync(bytes, length);
+		bytes += written;
+		length -= written;
+
+		/* Keeps draining while the buffer is full, even if the TX event is late or interrupts are off */
+		if(length)
+		{
+			kickTX();
+		}
+	}
+
+	/* Whatever the UART can take right away, the rest follows with the TX event */
+	kickTX();
+}
+
+uint32_t Serial::writeAsync(const uint8_t* bytes, uint32_t length)
+{
+	if(!tx_interrupts)
+	{
+		for(uint32_t i = 0; i < length; i++)
+		{
+			csr_write_simple(bytes[i], uart_base_addr + UART_TX_OFFSET);
+			csr_write_simple(1 << DIN_VLD_OFFSET, uart_base_addr + UART_CONTROL_OFFSET);
+
+			while(!txReady());
+		}
+		return length;
+	}
+
+	uint32_t space = txFree();
+	if(length > space)
+	{
+		length = space;
+	}
+
+	uint16_t head = tx_head;
 	for(uint32_t i = 0; i < length; i++)
 	{
-		write(bytes[i]);
+		tx_buffer[head] = bytes[i];
+		head = (head + 1) & (TX_BUF_SIZE - 1);
+	}
+	tx_head = head;
+
+	kickTX();
+
+	return length;
+}
+
+uint32_t Serial::txFree()
+{
+	/* One slot stays empty to tell a full buffer from an empty one */
+	return (tx_tail - tx_head - 1) & (TX_BUF_SIZE - 1);
+}
+
+void Serial::flush()
+{
+	/* Sends polled, so it cant hang on a TX event that never comes */
+	while(tx_head != tx_tail)
+	{
+		kickTX();
 	}
+
+	while(!txReady());
+}
+
+bool Serial::txReady()
+{
+	return csr_read_simple(uart_base_addr + UART_STATUS_OFFSET) & (1 << DIN_RDY_OFFSET);
+}
+
+void Serial::serviceTX()
+{
+	/* A stale event can arrive while a byte from kickTX() is still being sent, the next edge comes anyway */
+	if(tx_head == tx_tail || !txReady())
+	{
+		return;
+	}
+
+	csr_write_simple(tx_buffer[tx_tail], uart_base_addr + UART_TX_OFFSET);
+	csr_write_simple(1 << DIN_VLD_OFFSET, uart_base_addr + UART_CONTROL_OFFSET);
+	tx_tail = (tx_tail + 1) & (TX_BUF_SIZE - 1);
+}
+
+void Serial::kickTX()
+{
+	/* If the UART is still busy, its ready interrupt picks up the new bytes */
+	uint32_t ie = irq_getie();
+	irq_setie(0);
+	serviceTX();
+	irq_setie(ie);
 }
 
 uint8_t Serial::read()
@@ -107,8 +221,8 @@ uint8_t Serial::read()
 
 	while(isEmpty());
 
-	result = uart_buffer[read_head];
-	read_head = (read_head + 1) & (UART_BUF_SIZE - 1);
+	result = rx_buffer[read_head];
+	read_head = (read_head + 1) & rx_mask;
 
 	return result;
 }
@@ -116,30 +230,67 @@ uint8_t Serial::read()
 uint8_t Serial::readNonBlocking()
 {	
 	uint8_t result = 0x00;
-	static uint32_t timeout = 0;
-	while(isEmpty() && timeout < 0x124F80){ //100ms timeout
-		__asm__("nop");
-		timeout++;
-	}
+	read(result, READ_TIMEOUT);
 
-	if(timeout < 0x124F80){
-		result = uart_buffer[read_head];
-		read_head = (read_head + 1) & (UART_BUF_SIZE - 1);
+	return result;
+}
+
+bool Serial::read(uint8_t& byte, uint32_t timeoutTicks)
+{
+	if(isEmpty())
+	{
+		if(!deadline_timer || !timeoutTicks)
+		{
+			return false;
+		}
+
+		uint32_t start = deadline_timer->getTime();
+		while(isEmpty())
+		{
+			if(deadline_timer->passed(start) >= timeoutTicks)
+			{
+				return false;
+			}
+		}
 	}
 
-	return result;
+	byte = rx_buffer[read_head];
+	read_head = (read_head + 1) & rx_mask;
+
+	return true;
 }
 
-uint32_t Serial::bytesPending()
+void Serial::useTimer(Timer* timer)
 {
-	if(write_head >= read_head)
+	deadline_timer = timer;
+}
+
+size_t Serial::readAvailable(uint8_t* dst, size_t max)
+{
+	uint32_t head = read_head;
+	size_t count = bytesPending();
+	if(count > max)
 	{
-		return write_head - read_head;
+		count = max;
 	}
-	else
+
+	/* At most two copies, the second one starts at the beginning after the ring wrapped */
+	size_t first = rx_mask + 1 - head;
+	if(first > count)
 	{
-		return (UART_BUF_SIZE - read_head) + write_head;
+		first = count;
 	}
+	memcpy(dst, &rx_buffer[head], first);
+	memcpy(dst + first, rx_buffer, count - first);
+
+	read_head = (head + count) & rx_mask;
+
+	return count;
+}
+
+uint32_t Serial::bytesPending()
+{
+	return (write_head - read_head) & rx_mask;
 }
 
 bool Serial::isEmpty()
@@ -179,7 +330,10 @@ void Serial::printStatus()
 	"dout_vld 	= 	%d 	\n"
 	"fe 		= 	%d 	\n"
 	"pe 		= 	%d 	\n"
-	, din_rdy, dout_vld, fe, pe); 
+	"rx pending	= 	%lu	\n"
+	"rx dropped	= 	%lu	\n"
+	"rx overruns	= 	%lu	\n"
+	, din_rdy, dout_vld, fe, pe, bytesPending(), rx_dropped, rx_overruns); 
 }
 
 #endif
\ No newline at end of file
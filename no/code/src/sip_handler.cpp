@@ -1,3 +1,4 @@
+#define LOG_MODULE LOG_MODULE_SIP
 #include "sip_handler.h"
 
 SIPHandler::SIPHandler(Serial& obc): obc(obc)
@@ -12,60 +13,250 @@ bool SIPHandler::run(SIPCommand* command)
 	maybe some compiler optimization bug ??? */
 	test = 5;
 
-	/* Return instantly if there arent any Bytes in the Buffer */
-	if(!obc.bytesPending())
+	if(obc.getOverruns() != reported_overruns)
 	{
+		reported_overruns = obc.getOverruns();
+		LOGWARN("SIP RX buffer overrun, %lu bytes dropped so far", obc.getDroppedBytes());
+	}
+
+	/* Only takes what is already there, a partial frame is continued in the next call */
+	uint32_t pending = obc.bytesPending();
+	uint8_t byte;
+	while(pending-- && obc.read(byte, 0))
+	{
+		if(parse(command, byte))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool SIPHandler::parse(SIPCommand* command, uint8_t byte)
+{
+	if(byte == BOUNDARY)
+	{
+		/* Closes the current frame and opens the next one, empty frames between two boundaries are skipped */
+		bool complete = (state == FRAME_DATA && !escaped && frame_index >= 2 && frame_index == frame_length);
+		if(state == FRAME_DATA && frame_index && !complete)
+		{
+			LOGWARN("SIP frame cut off after %u bytes", frame_index);
+		}
+
+		bool ready = complete && finishFrame(command);
+
+		state = FRAME_DATA;
+		frame_index = 0;
+		frame_length = 0;
+		frame_crc = CRC16_INIT;
+		escaped = false;
+
+		return ready;
+	}
+
+	if(state != FRAME_DATA)
+	{
+		return false;
+	}
+
+	if(byte == ESCAPE)
+	{
+		escaped = true;
 		return false;
 	}
 
-	buffer_index = 0;
-	uint8_t first_byte = obc.read();
-	buffer[buffer_index++] = first_byte;
-	
-	/* Get all bytes till the end of the frame is recognized */
-	uint8_t cur_byte = 0;
-	do
+	if(escaped)
+	{
+		/* BOUNDARY_REPLACE and ESCAPE_REPLACE are the escaped bytes with bit 5 flipped */
+		byte ^= 0x20;
+		escaped = false;
+	}
+
+	/* Decoded Bytes go straight to their place in the command: length (big endian), sequence, 
+	 * payload address, function code, data and crc (big endian), everything but the crc is in the crc */
+	SIP<sizeof(command->sip_data.data)>& sip = command->sip_data;
+	if(frame_length && frame_index >= frame_length)
+	{
+		LOGWARN("SIP frame longer than its length field");
+		state = FRAME_DISCARD;
+		return false;
+	}
+
+	if(frame_index < 2 || frame_index < sip.length)
+	{
+		frame_crc = crc16_ccitt_update(frame_crc, &byte, 1);
+	}
+
+	switch(frame_index)
+	{
+		case 0:
+		{
+			sip.length = byte << 8;
+			break;
+		}
+		case 1:
+		{
+			sip.length |= byte;
+			if(sip.length < LENGTH_WITHOUT_DATA || sip.length > LENGTH_WITHOUT_DATA + sizeof(sip.data))
+			{
+				LOGWARN("SIP frame with invalid length %u", sip.length);
+				state = FRAME_DISCARD;
+				return false;
+			}
+			sip.data_length = sip.length - LENGTH_WITHOUT_DATA;
+			frame_length = sip.length + sizeof(sip.crc);
+			break;
+		}
+		case 2:
+		{
+			sip.sequence = byte;
+			break;
+		}
+		case 3:
+		{
+			sip.pow_or_addr = byte;
+			break;
+		}
+		case 4:
+		{
+			sip.code_or_type = byte;
+			break;
+		}
+		default:
+		{
+			if(frame_index < sip.length)
+			{
+				sip.data[frame_index - LENGTH_WITHOUT_DATA] = byte;
+			}
+			else if(frame_index == sip.length)
+			{
+				sip.crc = byte << 8;
+			}
+			else
+			{
+				sip.crc |= byte;
+			}
+			break;
+		}
+	}
+
+	frame_index++;
+	return false;
+}
+
+bool SIPHandler::finishFrame(SIPCommand* command)
+{
+	SIP<sizeof(command->sip_data.data)>& sip = command->sip_data;
+	sip.length_without_crc_and_length_field = sip.length - sizeof(sip.crc) - sizeof(sip.length);
+
+	if(sip.crc != frame_crc)
 	{
-		uint8_t readbyte = obc.read();
-		cur_byte = readbyte;
-		buffer[buffer_index++] = cur_byte;
-	} while (cur_byte != BOUNDARY);
-	
-	SIPResult result = command->fetch(buffer, buffer_index);
+		LOGWARN("SIP frame with CRC 0x%X instead of 0x%X dropped", sip.crc, frame_crc);
+		return false;
+	}
+
 	return true;
 }
 
-void SIPHandler::sendResponse(SIPReponse response)
+void SIPHandler::writeEscaped(const uint8_t* bytes, uint32_t length)
+{
+	uint32_t run_start = 0;
+
+	for(uint32_t i = 0; i < length; i++)
+	{
+		if(!SIPUtil::hdlc_needs_escape(bytes[i]))
+		{
+			continue;
+		}
+
+		/* Bytes up to the escaped one go out in one piece */
+		obc.write(const_cast<uint8_t*>(bytes + run_start), i - run_start);
+		obc.write(ESCAPE);
+		obc.write(bytes[i] ^ 0x20);
+		run_start = i + 1;
+	}
+
+	obc.write(const_cast<uint8_t*>(bytes + run_start), length - run_start);
+}
+
+void SIPHandler::sendResponse(const SIPReponse& response)
+{
+	beginResponse(response.sip_data.sequence, response.sip_data.pow_or_addr, response.sip_data.code_or_type, response.sip_data.data_length);
+	writeResponseData(response.sip_data.data, response.sip_data.data_length);
+	endResponse();
+}
+
+void SIPHandler::beginResponse(uint8_t sequence, uint8_t power_state, uint8_t response_type, uint16_t data_len)
 {
-	//response.printAsLog();
+	uint16_t length = LENGTH_WITHOUT_DATA + data_len;
+	/* Length goes out as big endian, the CRC covers it the same way */
+	uint8_t header[] = {static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(length & 0xFF), sequence, power_state, response_type};
+
+	response_crc = crc16_ccitt_update(CRC16_INIT, header, sizeof(header));
+	response_remaining = data_len;
+	response_cut_off = 0;
+
 	obc.write(BOUNDARY);
-	/* Convert length to big endian before sending */
-	uint16_t be_length = SIPUtil::littleToBigEndian(response.getLength());
-	obc.write(reinterpret_cast<uint8_t*>(&be_length), sizeof(be_length));
+	writeEscaped(header, sizeof(header));
+}
+
+void SIPHandler::writeResponseData(const uint8_t* data, uint32_t len)
+{
+	if(len > response_remaining)
+	{
+		/* Logged by endResponse(), log output would end up inside the frame */
+		response_cut_off += len - response_remaining;
+		len = response_remaining;
+	}
 
-	/* Send everything but not crc or length */
-	obc.write(reinterpret_cast<uint8_t*>(&response.sip_data) + sizeof(response.sip_data.length), 
-	response.sip_data.length_without_crc_and_length_field + 2);
+	response_crc = crc16_ccitt_update(response_crc, data, len);
+	response_remaining -= len;
+	writeEscaped(data, len);
+}
 
-	/* Convert crc to big endian before sending */
-	uint16_t be_crc = SIPUtil::littleToBigEndian(response.getCRC());
-	obc.write(reinterpret_cast<uint8_t*>(&be_crc), sizeof(be_crc));
+void SIPHandler::endResponse()
+{
+	uint32_t padded = response_remaining;
 
+	const uint8_t zero = 0;
+	while(response_remaining > 0)
+	{
+		writeResponseData(&zero, 1);
+	}
+
+	uint8_t crc_bytes[] = {static_cast<uint8_t>(response_crc >> 8), static_cast<uint8_t>(response_crc & 0xFF)};
+	writeEscaped(crc_bytes, sizeof(crc_bytes));
 	obc.write(BOUNDARY);
+
+	/* SIP and the log share the UART, so this has to wait until the frame is complete */
+	if(response_cut_off > 0)
+	{
+		LOGWARN("Response data cut off by %d Bytes", response_cut_off);
+	}
+
+	if(padded > 0)
+	{
+		LOGWARN("Response data padded by %d Bytes", padded);
+	}
 }
 
 void SIPHandler::sendAck(uint8_t sequence)
 {
-	SIPReponse response;
-	uint8_t response_data[] = {ACK};
-	response.build(sequence, POWERED_ON, Response::ACK_NACK_RESPONSE_ID, response_data, 1);
-	sendResponse(response);
+	sendAckNack(sequence, ACK, nullptr, 0);
 }
 
 void SIPHandler::sendNack(uint8_t sequence)
 {
-	SIPReponse response;
-	uint8_t response_data[] = {NACK};
-	response.build(sequence, POWERED_ON, Response::ACK_NACK_RESPONSE_ID, response_data, 1);
-	sendResponse(response);
+	sendAckNack(sequence, NACK, nullptr, 0);
+}
+
+void SIPHandler::sendAckNack(uint8_t sequence, uint8_t ack, const uint8_t* data, uint16_t len)
+{
+	if(len > ACK_DATA_SIZE) len = ACK_DATA_SIZE;
+
+	beginResponse(sequence, POWERED_ON, Response::ACK_NACK_RESPONSE_ID, len + 1);
+	writeResponseData(&ack, 1);
+	writeResponseData(data, len);
+	endResponse();
 }
@@ -0,0 +1,32 @@
+#define LOG_MODULE LOG_MODULE_SIP
+#include "sipcommandrouter.h"
+
+SipCommandRouter::SipCommandRouter(SipResponseSink& sip) : sip(sip)
+{
+}
+
+bool SipCommandRouter::add(uint8_t function_code, SipCommandHandler* handler)
+{
+	if(function_code >= SIP_ROUTER_TABLE_SIZE || handlers[function_code])
+	{
+		LOGWARN("Function code 0x%X can not be registered", function_code);
+		return false;
+	}
+
+	handlers[function_code] = handler;
+	return true;
+}
+
+void SipCommandRouter::dispatch(SIPCommand& command)
+{
+	uint8_t function_code = command.getFunctionCode();
+
+	if(function_code >= SIP_ROUTER_TABLE_SIZE || !handlers[function_code])
+	{
+		LOGWARN("Unknown function code 0x%X", function_code);
+		sip.sendNack(command.getSequenceNum());
+		return;
+	}
+
+	handlers[function_code]->handle(command);
+}
@@ -0,0 +1,556 @@
+#define LOG_MODULE LOG_MODULE_SIP
+#include "sipcommands.h"
+
+/**
+ * @brief Writes len Bytes of the HyperRAM or flash into the started response
+ */
+static void streamMemory(SipResponseSink& sip, MemoryContext& memory, bool from_flash, uint32_t address, uint32_t len)
+{
+	if(!from_flash)
+	{
+		sip.writeResponseData((uint8_t*)memory.hyperram + address, len);
+		return;
+	}
+
+	/* The flash is read page by page, only one page has to fit on the stack */
+	uint8_t page[MX25R6435F::PAGE_SIZE];
+	for(uint32_t offset = 0; offset < len; offset += sizeof(page))
+	{
+		uint32_t chunk = MIN(sizeof(page), len - offset);
+		memory.flash.read(address + offset, page, chunk);
+		sip.writeResponseData(page, chunk);
+	}
+}
+
+void RisaInitHandler::handle(SIPCommand& command)
+{
+	sip.sendAck(command.getSequenceNum());
+}
+
+void ShutdownHandler::handle(SIPCommand& command)
+{
+	for(uint8_t i = 0; i < experiment_count; i++)
+	{
+		/* Flushes the last incomplete word of the results */
+		experiments[i]->getResults();
+	}
+	memory.journal.flush();
+
+	sip.sendAck(command.getSequenceNum());
+	obc.flush();
+}
+
+void ExperimentCommandHandler::handle(SIPCommand& command)
+{
+	switch(command.getFunctionCode())
+	{
+		case Command::TEST_START_COMMAND_ID:
+		{
+			testStart(command);
+			break;
+		}
+		case Command::TEST_STATUS_COMMAND_ID:
+		{
+			testStatus(command);
+			break;
+		}
+		case Command::TESTDATA_COMMAND_ID:
+		{
+			testData(command);
+			break;
+		}
+		default:
+		{
+			sip.sendNack(command.getSequenceNum());
+			break;
+		}
+	}
+}
+
+void ExperimentCommandHandler::testStart(SIPCommand& command)
+{
+	uint8_t test_id = command.getData()[0];
+	uint16_t test_duration = command.getData()[1] | command.getData()[2] << 8;
+	uint16_t test_size = command.getData()[3] | command.getData()[4] << 8;
+
+	/* Test parameter kann man weiterführen wie man will */
+	uint16_t test_param = command.getData()[5] | command.getData()[6] << 8;
+
+	if(test_id >= experiment_count)
+	{
+		sip.sendNack(command.getSequenceNum());
+		return;
+	}
+
+	current_test = test_id;
+	manager.startExperiment(experiments[test_id]);
+	sip.sendAck(command.getSequenceNum());
+}
+
+void ExperimentCommandHandler::testStatus(SIPCommand& command)
+{
+	uint8_t asked_id = command.getData()[0];
+
+	if(asked_id != current_test)
+	{
+		/* What to do if this happens ?*/
+	}
+
+	uint8_t current_state = manager.cur_state;
+	uint8_t test_data_size = 0;
+
+	uint8_t responsearr[] = {current_state, test_data_size};
+	sip.beginResponse(command.getSequenceNum(), POWERED_ON, Response::TEST_STATUS_RESPONSE_ID, sizeof(responsearr));
+	sip.writeResponseData(responsearr, sizeof(responsearr));
+	sip.endResponse();
+}
+
+void ExperimentCommandHandler::testData(SIPCommand& command)
+{
+	uint8_t test_id = command.getData()[0];
+	uint16_t test_size = command.getData()[1] | command.getData()[2] << 8;
+
+	if(test_id >= experiment_count)
+	{
+		sip.sendNack(command.getSequenceNum());
+		return;
+	}
+
+	HyperRamRegion* results = experiments[test_id]->getResults();
+	/* Same limit as MEMORY_DUMP, the length field of the frame has to hold it */
+	test_size = MIN(test_size, 4096);
+	test_size = MIN(test_size, results->getUsed());
+
+	sip.beginResponse(command.getSequenceNum(), POWERED_ON, Response::TESTDATA_RESPONSE_ID, test_size);
+	sip.writeResponseData((uint8_t*)results->getData(), test_size);
+	sip.endResponse();
+}
+
+void MemoryWriteHandler::handle(SIPCommand& command)
+{
+	if(command.getFunctionCode() == Command::MEMORY_WRITE_INIT_COMMAND_ID)
+	{
+		writeInit(command);
+	}
+	else
+	{
+		writeData(command);
+	}
+}
+
+void MemoryWriteHandler::verifyChunk(const FlashJob& job, void* context)
+{
+	VerifyChunk* chunk = static_cast<VerifyChunk*>(context);
+	uint8_t readback[MX25R6435F::PAGE_SIZE];
+	uint16_t crc = CRC16_INIT;
+
+	/* Chunks can be bigger than a page, so they are read back piece by piece */
+	for(uint32_t offset = 0; offset < chunk->len; offset += sizeof(readback))
+	{
+		uint32_t len = MIN(sizeof(readback), chunk->len - offset);
+		chunk->flash->read(chunk->address + offset, readback, len);
+		crc = crc16_ccitt_update(crc, readback, len);
+	}
+	uint8_t crc_bytes[] = {static_cast<uint8_t>(crc & 0xFF), static_cast<uint8_t>(crc >> 8)};
+
+	if(crc != chunk->expected_crc)
+	{
+		LOGWARN("Verify failed at Flash address %d, CRC 0x%X instead of 0x%X", chunk->address, crc, chunk->expected_crc);
+	}
+
+	chunk->sip_handler->sendAckNack(chunk->sequence, (crc == chunk->expected_crc) ? ACK : NACK, crc_bytes, sizeof(crc_bytes));
+}
+
+void MemoryWriteHandler::writeInit(SIPCommand& command)
+{
+	if(write_active)
+	{
+		/* Already busy in writing mode */
+		sip.sendNack(command.getSequenceNum());
+		write_active = false;
+		return;
+	}
+
+	/* First Byte is the Memory Type */
+	write_flash = command.getData()[0];
+	/* Next 3 Bytes are Memory Address */
+	write_addr = command.getData()[1] | command.getData()[2] << 8 | command.getData()[3] << 16;
+	/* Next 3 Bytes are the Length, at most 0xFFFFFF, the write has to end within the 8 MB flash
+	 * or within HYPER_RAM_SIZE outside of the arena regions */
+	write_len = command.getData()[4] | command.getData()[5] << 8 | command.getData()[6] << 16;
+	/* Optional 8th Byte enables the verify mode, every chunk is read back and acked with its CRC16 */
+	write_verify = command.getDataLength() > 7 && command.getData()[7];
+	/* Optional 9th Byte enables the pipelined mode, the verify mode acks each chunk on its own and stays without it */
+	write_pipelined = !write_verify && command.getDataLength() > 8 && command.getData()[8];
+
+	if(write_flash)
+	{
+		if(write_addr + write_len > MX25R6435F::FLASH_SIZE)
+		{
+			LOGWARN("Flash write to %d with length %d rejected, it runs past the end", write_addr, write_len);
+			sip.sendNack(command.getSequenceNum());
+			return;
+		}
+
+		LOGINFO("Starting write to Flash address %d, with length %d", write_addr, write_len);
+	}
+	else
+	{
+		/* Only the free HyperRAM above the arena can be written, the regions belong to the experiments and the programmer */
+		HyperRamRegion* overlap = memory.arena.findOverlap(write_addr, write_len);
+		if(write_addr + write_len > HYPER_RAM_SIZE || overlap)
+		{
+			LOGWARN("Ram write to %d with length %d rejected, it overlaps %s", write_addr, write_len, overlap ? overlap->getName() : "the end");
+			sip.sendNack(command.getSequenceNum());
+			return;
+		}
+
+		LOGINFO("Starting write to Ram address %d, with length %d", write_addr, write_len);
+	}
+
+	/* Gotta erase the flash before writing it, runs in the background
+	 * and is suspended whenever the flash gets read in the meantime */
+	if(write_flash)
+	{
+		memory.flash_jobs.waitForSlots(1);
+		memory.flash_jobs.submitErase(write_addr, write_len);
+	}
+
+	/* We are now actively in writing mode */
+	write_active = true;
+	write_index = 0;
+	sip.sendAck(command.getSequenceNum());
+}
+
+void MemoryWriteHandler::sendProgress(uint8_t sequence)
+{
+	uint8_t progress[] = {static_cast<uint8_t>(write_index), static_cast<uint8_t>(write_index >> 8), static_cast<uint8_t>(write_index >> 16)};
+	sip.sendAckNack(sequence, ACK, progress, sizeof(progress));
+}
+
+void MemoryWriteHandler::writeData(SIPCommand& command)
+{
+	if(!write_active)
+	{
+		if(write_pipelined && write_len > 0 && write_index >= write_len)
+		{
+			/* The last ACK got lost and the host sends the end again */
+			sendProgress(command.getSequenceNum());
+			return;
+		}
+
+		/* Never had a Writing mode initialized */
+		sip.sendNack(command.getSequenceNum());
+		return;
+	}
+
+	/* First 2 bytes indicate length, in pipelined mode the 3 Byte offset of the chunk follows */
+	uint16_t header = write_pipelined ? 5 : 2;
+	uint16_t len = command.getData()[0] | command.getData()[1] << 8;
+	/* A chunk can be as big as the command buffer */
+	if(command.getDataLength() < header || len > command.getDataLength() - header)
+	{
+		sip.sendNack(command.getSequenceNum());
+		write_active = false;
+		return;
+	}
+
+	if(write_pipelined)
+	{
+		uint32_t offset = command.getData()[2] | command.getData()[3] << 8 | command.getData()[4] << 16;
+		if(offset != write_index)
+		{
+			/* A chunk before this one got lost or this one came again, the ACK tells the host where to go on */
+			sendProgress(command.getSequenceNum());
+			return;
+		}
+	}
+
+	if(len > (write_len - write_index))
+	{
+		/* Sending too many Bytes Write aborted */
+		sip.sendNack(command.getSequenceNum());
+		write_active = false;
+		return;
+	}
+
+	/* Following bytes are the data */
+	const uint8_t* chunk_data = command.getData() + header;
+	uint32_t chunk_addr = write_addr + write_index;
+	if(write_flash)
+	{
+		/* The data gets copied page by page, so the chunk can be acked right away
+		 * and the pages are programmed while the next chunks arrive */
+		uint32_t pages = ((chunk_addr & (MX25R6435F::PAGE_SIZE - 1)) + len + MX25R6435F::PAGE_SIZE - 1) / MX25R6435F::PAGE_SIZE;
+		memory.flash_jobs.waitForSlots(pages);
+
+		if(write_verify)
+		{
+			/* Acked from the callback once the chunk is programmed */
+			VerifyChunk& chunk = verify_chunks[verify_index];
+			verify_index = (verify_index + 1) & (FLASH_JOB_QUEUE_DEPTH - 1);
+
+			chunk.sip_handler = &sip;
+			chunk.flash = &memory.flash;
+			chunk.address = chunk_addr;
+			chunk.len = len;
+			chunk.expected_crc = crc16_ccitt(chunk_data, len);
+			chunk.sequence = command.getSequenceNum();
+
+			memory.flash_jobs.submitProgram(chunk_addr, chunk_data, len, verifyChunk, &chunk);
+		}
+		else
+		{
+			memory.flash_jobs.submitProgram(chunk_addr, chunk_data, len);
+		}
+		write_index += len;
+	}
+	else
+	{
+		for(uint32_t i = 0; i < len; i++)
+		{
+			memory.hyperram[write_addr + write_index++] = chunk_data[i];
+		}
+	}
+
+	if(write_index >= write_len)
+	{
+		/* Sucessfully written all bytes, logged once per transfer since the log shares the UART with the chunks */
+		write_active = false;
+		LOGINFO("Written %d bytes to %s address %d", write_len, write_flash ? "Flash" : "Ram", write_addr);
+	}
+
+	if(write_pipelined)
+	{
+		sendProgress(command.getSequenceNum());
+	}
+	else if(!write_verify)
+	{
+		sip.sendAck(command.getSequenceNum());
+	}
+	else if(!write_flash)
+	{
+		uint16_t crc = crc16_ccitt((uint8_t*)memory.hyperram + chunk_addr, len);
+		uint8_t crc_bytes[] = {static_cast<uint8_t>(crc & 0xFF), static_cast<uint8_t>(crc >> 8)};
+		bool verified = (crc == crc16_ccitt(chunk_data, len));
+		sip.sendAckNack(command.getSequenceNum(), verified ? ACK : NACK, crc_bytes, sizeof(crc_bytes));
+	}
+}
+
+void MemoryDumpHandler::handle(SIPCommand& command)
+{
+	/* First Byte is the Memory Type */
+	bool dump_flash = command.getData()[0];
+	/* Next 3 Bytes are Memory Address */
+	uint32_t dump_addr = command.getData()[1] | command.getData()[2] << 8 | command.getData()[3] << 16;
+	/* Next 2 Bytes is Length, maximum 4096 */
+	uint32_t dump_len = command.getData()[4] | command.getData()[5] << 8;
+	if(dump_len > 4096) { sip.sendNack(command.getSequenceNum()); return; }
+
+	if(dump_flash)
+	{
+		LOGINFO("Dumping from Flash address %d, with length %d", dump_addr, dump_len);
+	}
+	else
+	{
+		LOGINFO("Dumping from Ram address %d, with length %d", dump_addr, dump_len);
+	}
+
+	sip.beginResponse(command.getSequenceNum(), POWERED_ON, MEMORY_DUMP_RESPONSE_ID, dump_len);
+	streamMemory(sip, memory, dump_flash, dump_addr, dump_len);
+	sip.endResponse();
+}
+
+void BulkReadHandler::handle(SIPCommand& command)
+{
+	if(command.getFunctionCode() == Command::BULK_READ_COMMAND_ID)
+	{
+		start(command);
+	}
+	else
+	{
+		resume(command);
+	}
+}
+
+void BulkReadHandler::start(SIPCommand& command)
+{
+	/* A new BULK_READ always replaces the running transfer */
+	active = false;
+
+	if(command.getDataLength() < 11)
+	{
+		sip.sendNack(command.getSequenceNum());
+		return;
+	}
+
+	const uint8_t* data = command.getData();
+	uint8_t source = data[0];
+	uint32_t start_addr = data[1] | data[2] << 8 | data[3] << 16;
+	uint32_t len = data[4] | data[5] << 8 | data[6] << 16 | (uint32_t)data[7] << 24;
+	uint16_t size = data[8] | data[9] << 8;
+	uint8_t win = data[10];
+
+	if(size == 0 || size > FRAME_DATA_MAX || win == 0)
+	{
+		sip.sendNack(command.getSequenceNum());
+		return;
+	}
+
+	if(source == BULK_SOURCE_TESTDATA)
+	{
+		uint8_t test_id = command.getDataLength() > 11 ? data[11] : 0;
+		if(test_id >= experiment_count)
+		{
+			sip.sendNack(command.getSequenceNum());
+			return;
+		}
+
+		/* Only what has been recorded so far can be read */
+		HyperRamRegion* results = experiments[test_id]->getResults();
+		uint32_t used = results->getUsed();
+		start_addr = MIN(start_addr, used);
+		len = MIN(len, used - start_addr);
+		start_addr += results->getOffset();
+		from_flash = false;
+	}
+	else if(source == BULK_SOURCE_RAM || source == BULK_SOURCE_FLASH)
+	{
+		from_flash = (source == BULK_SOURCE_FLASH);
+		/* Reads past the end of the flash would wrap around to its start */
+		uint32_t memory_size = from_flash ? MX25R6435F::FLASH_SIZE : HYPER_RAM_SIZE;
+		if(start_addr > memory_size || len > memory_size - start_addr)
+		{
+			sip.sendNack(command.getSequenceNum());
+			return;
+		}
+	}
+	else
+	{
+		sip.sendNack(command.getSequenceNum());
+		return;
+	}
+
+	sequence = command.getSequenceNum();
+	address = start_addr;
+	length = len;
+	frame_size = size;
+	/* Never 0, a frame is at most FRAME_DATA_MAX */
+	window = MIN(MIN(win, WINDOW_MAX), WINDOW_BYTES_MAX / frame_size);
+	frame_count = (length + frame_size - 1) / frame_size;
+	next_frame = 0;
+	active = true;
+
+	LOGINFO("Bulk read of %d Bytes from address %d in %d frames", length, address, frame_count);
+
+	/* The length fits 3 Bytes as it never exceeds the memory */
+	uint8_t ack_data[] =
+	{
+		static_cast<uint8_t>(frame_count), static_cast<uint8_t>(frame_count >> 8),
+		static_cast<uint8_t>(frame_count >> 16), static_cast<uint8_t>(frame_count >> 24),
+		static_cast<uint8_t>(length), static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(length >> 16),
+		window,
+	};
+	sip.sendAckNack(sequence, ACK, ack_data, sizeof(ack_data));
+
+	for(uint8_t sent = 0; sent < window && next_frame < frame_count; sent++)
+	{
+		sendFrame(next_frame++);
+	}
+}
+
+void BulkReadHandler::resume(SIPCommand& command)
+{
+	if(!active)
+	{
+		sip.sendNack(command.getSequenceNum());
+		return;
+	}
+
+	uint8_t sent = 0;
+	const uint8_t* data = command.getData();
+
+	/* Missing frames go first, frames that were never sent are skipped as they come next anyway */
+	for(uint16_t i = 0; i + 4 <= command.getDataLength() && sent < window; i += 4)
+	{
+		uint32_t frame = data[i] | data[i + 1] << 8 | data[i + 2] << 16 | (uint32_t)data[i + 3] << 24;
+		if(frame < next_frame)
+		{
+			sendFrame(frame);
+			sent++;
+		}
+	}
+
+	for(; sent < window && next_frame < frame_count; sent++)
+	{
+		sendFrame(next_frame++);
+	}
+
+	if(sent == 0)
+	{
+		/* Nothing missing and everything sent */
+		LOGINFO("Bulk read finished");
+		active = false;
+		sip.sendAck(command.getSequenceNum());
+	}
+}
+
+void BulkReadHandler::sendFrame(uint32_t frame)
+{
+	uint32_t offset = frame * frame_size;
+	uint32_t len = MIN(frame_size, length - offset);
+	uint8_t header[FRAME_HEADER_SIZE] =
+	{
+		static_cast<uint8_t>(frame), static_cast<uint8_t>(frame >> 8),
+		static_cast<uint8_t>(frame >> 16), static_cast<uint8_t>(frame >> 24),
+	};
+
+	sip.beginResponse(sequence, POWERED_ON, Response::BULK_DATA_RESPONSE_ID, sizeof(header) + len);
+	sip.writeResponseData(header, sizeof(header));
+	streamMemory(sip, memory, from_flash, address + offset, len);
+	sip.endResponse();
+}
+
+void SlotRegisterHandler::handle(SIPCommand& command)
+{
+	if(command.getDataLength() < 9)
+	{
+		sip.sendNack(command.getSequenceNum());
+		return;
+	}
+
+	const uint8_t* data = command.getData();
+	uint8_t slot_id = data[0];
+	uint32_t offset = data[1] | data[2] << 8 | data[3] << 16;
+	uint32_t length = data[4] | data[5] << 8 | data[6] << 16;
+	uint16_t version = data[7] | data[8] << 8;
+
+	if(slot_id >= SLOT_COUNT || !length || offset + length > MX25R6435F::FLASH_SIZE)
+	{
+		LOGWARN("Rejected slot %d: offset %d, length %d", slot_id, offset, length);
+		sip.sendNack(command.getSequenceNum());
+		return;
+	}
+
+	/* The last chunks of the upload may still be queued, the CRC has to see the programmed image */
+	memory.flash_jobs.waitIdle();
+
+	programmer.slots.registerSlot(slot_id, offset, length, version);
+	/* The ICE40 may still hold the old image of this slot */
+	programmer.invalidate();
+
+	uint32_t crc = programmer.slots.get(slot_id)->crc;
+	uint8_t crc_bytes[] = {static_cast<uint8_t>(crc), static_cast<uint8_t>(crc >> 8), static_cast<uint8_t>(crc >> 16), static_cast<uint8_t>(crc >> 24)};
+	sip.sendAckNack(command.getSequenceNum(), ACK, crc_bytes, sizeof(crc_bytes));
+}
+
+void LogLevelHandler::handle(SIPCommand& command)
+{
+	if(command.getDataLength() < 2 || !logSetLevel(command.getData()[0], command.getData()[1]))
+	{
+		sip.sendNack(command.getSequenceNum());
+		return;
+	}
+
+	sip.sendAckNack(command.getSequenceNum(), ACK, log_levels, LOG_MODULE_COUNT);
+}
@@ -68,4 +68,104 @@ void SPI::writeByte(uint8_t byte)
 	startTX();
 }
 
+void SPI::readBurst(uint8_t* dst, uint32_t len)
+{
+	readBurst(static_cast<volatile uint8_t*>(dst), len);
+}
+
+void SPI::readBurst(volatile uint8_t* dst, uint32_t len)
+{
+	if(!len) return;
+
+	/* The Control Register only has to be read once for the whole burst */
+	uint32_t start_content = csr_read_simple(spi_base_addr + SPI_CONTROL_OFFSET) | (1 << SPI_ENABLE_OFFSET);
+
+	/* TX gets latched by the master when a transfer starts, so the dummy byte stays loaded */
+	waitTillReady();
+	csr_write_simple(0xFF, spi_base_addr + SPI_TX_OFFSET);
+	csr_write_simple(start_content, spi_base_addr + SPI_CONTROL_OFFSET);
+
+	for(uint32_t i = 0; i < len - 1; i++)
+	{
+		waitTillReady();
+		/* RX has to be fetched before the next transfer starts, it is overwritten shortly after
+		 * and an interrupt in between would shift the data */
+		dst[i] = csr_read_simple(spi_base_addr + SPI_RX_OFFSET) & 0xFF;
+		csr_write_simple(start_content, spi_base_addr + SPI_CONTROL_OFFSET);
+	}
+
+	waitTillReady();
+	dst[len - 1] = csr_read_simple(spi_base_addr + SPI_RX_OFFSET) & 0xFF;
+}
+
+void SPI::beginReadBurst()
+{
+	burst_content = csr_read_simple(spi_base_addr + SPI_CONTROL_OFFSET) | (1 << SPI_ENABLE_OFFSET);
+
+	waitTillReady();
+	csr_write_simple(0xFF, spi_base_addr + SPI_TX_OFFSET);
+	csr_write_simple(burst_content, spi_base_addr + SPI_CONTROL_OFFSET);
+}
+
+uint8_t SPI::nextReadBurst(bool more)
+{
+	waitTillReady();
+	/* Same as readBurst(), RX is fetched before the next transfer can overwrite it */
+	uint8_t byte = csr_read_simple(spi_base_addr + SPI_RX_OFFSET) & 0xFF;
+	if(more)
+	{
+		csr_write_simple(burst_content, spi_base_addr + SPI_CONTROL_OFFSET);
+	}
+
+	return byte;
+}
+
+void SPI::writeBurst(const uint8_t* src, uint32_t len)
+{
+	uint32_t start_content = csr_read_simple(spi_base_addr + SPI_CONTROL_OFFSET) | (1 << SPI_ENABLE_OFFSET);
+
+	for(uint32_t i = 0; i < len; i++)
+	{
+		/* Load the next byte while the last one is still being shifted out */
+		csr_write_simple(src[i], spi_base_addr + SPI_TX_OFFSET);
+		waitTillReady();
+		csr_write_simple(start_content, spi_base_addr + SPI_CONTROL_OFFSET);
+	}
+}
+
+void SPI::readBurstWhileWriting(uint8_t* dst, uint32_t read_len, SPI& target, const uint8_t* src, uint32_t write_len)
+{
+	uint32_t read_content = csr_read_simple(spi_base_addr + SPI_CONTROL_OFFSET) | (1 << SPI_ENABLE_OFFSET);
+	uint32_t write_content = csr_read_simple(target.spi_base_addr + SPI_CONTROL_OFFSET) | (1 << SPI_ENABLE_OFFSET);
+	uint32_t count = (read_len > write_len) ? read_len : write_len;
+
+	if(read_len)
+	{
+		waitTillReady();
+		csr_write_simple(0xFF, spi_base_addr + SPI_TX_OFFSET);
+		csr_write_simple(read_content, spi_base_addr + SPI_CONTROL_OFFSET);
+	}
+
+	for(uint32_t i = 0; i < count; i++)
+	{
+		if(i < write_len)
+		{
+			csr_write_simple(src[i], target.spi_base_addr + SPI_TX_OFFSET);
+			target.waitTillReady();
+			csr_write_simple(write_content, target.spi_base_addr + SPI_CONTROL_OFFSET);
+		}
+
+		if(i < read_len)
+		{
+			waitTillReady();
+			/* Same as readBurst(), RX is fetched before the next transfer can overwrite it */
+			dst[i] = csr_read_simple(spi_base_addr + SPI_RX_OFFSET) & 0xFF;
+			if(i + 1 < read_len)
+			{
+				csr_write_simple(read_content, spi_base_addr + SPI_CONTROL_OFFSET);
+			}
+		}
+	}
+}
+
 #endif
\ No newline at end of file
@@ -1,3 +1,4 @@
+#define LOG_MODULE LOG_MODULE_SENSORS
 #include "tmp117.h" 
 
 TMP117::TMP117(I2C& i2c_dev, uint8_t id): i2c(i2c_dev), device_id(id)
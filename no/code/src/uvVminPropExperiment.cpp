@@ -1,3 +1,4 @@
+#define LOG_MODULE LOG_MODULE_UVVMIN
 #include "uvVminPropExperiment.h"
 
 bool UvVminPropExperiment::init(){
@@ -33,10 +34,7 @@ bool UvVminPropExperiment::init(){
 	gpioSetup(GPIO_DATA, GPIO_INPUT);
 
 	/* ICE40 Programming (ring oscillator: ice40_io_vcore_0 & ice40_io_vcore_1)*/
-	SPI ice40_spi(SPIDevice::ICE40);
-	ice40_spi.init(1, 0);
-	ICE40PROG ice40prog(memory.flash, ice40_spi);
-	ice40prog.programm(CONFIG_OFFSETS::ICE40_CONFIG);
+	programmer.programm(ICE40_CONFIG);
 	delayms(10);
 	sensors.enableICE40OSC(false);
 
@@ -45,11 +43,9 @@ bool UvVminPropExperiment::init(){
 	remainigRunsPerIntervall = 0;
 
 	//Logging header
-	hyperramAddUint8_t('E');
-	hyperramAddUint8_t('X');
-	hyperramAddUint8_t('P');
-	hyperramAddUint8_t(EXPERIMENT_ID);
-	hyperramAddUint8_t('#');
+	record.begin(RECORD_EXPERIMENT_START, runningTime());
+	record.put8(EXPERIMENT_ID);
+	record.end();
 
 	return true;
 }
@@ -62,13 +58,11 @@ ExperimentState UvVminPropExperiment::run(){
 
 	leds_out_write(0x00);
 	if ((remainigTestIntervalls == 0 and remainigRunsPerIntervall == 0) or finished) {
-		hyperramAddUint16_t(ramPos);
-		hyperramAddUint32_t(runningTime());
-		hyperramAddUint8_t('d');
-		hyperramAddUint8_t('o');
-		hyperramAddUint8_t('n');
-		hyperramAddUint8_t('e');
-		LOGINFO("Experiment %u finished! time=%lu ram=%lu", EXPERIMENT_ID, runningTime(), ramPos);
+		uint32_t recorded = record.getUsed();
+		record.begin(RECORD_EXPERIMENT_END, runningTime());
+		record.put32(recorded);
+		record.end();
+		LOGINFO("Experiment %u finished! time=%lu ram=%lu", EXPERIMENT_ID, runningTime(), record.getUsed());
 		return ExperimentState::TEST_FINISHED;
 	}else{
 		return ExperimentState::STILL_RUNNING;
@@ -115,7 +109,6 @@ uint32_t UvVminPropExperiment::runningTime(void){
 
 bool UvVminPropExperiment::makeTest(){
 	LOGINFO("Test voltage=%ld", voltage);
-	hyperramAddUint16_t(voltage);
 
 	//setup	
 	sensors.dac.setVoltage(voltage);
@@ -152,10 +145,10 @@ bool UvVminPropExperiment::makeTest(){
 
 	//add counter value
 	LOGINFO("data=%lu\n",data);
-	hyperramAddUint32_t(data);
-
-	//add sperator;
-	hyperramAddUint8_t('#');
+	record.begin(RECORD_UVVMIN_TEST, runningTime());
+	record.put16(voltage);
+	record.put32(data);
+	record.end();
 
 	if(data==0 or data==0xFFFFF){
 		return true;
@@ -166,33 +159,17 @@ bool UvVminPropExperiment::makeTest(){
 
 void UvVminPropExperiment::readingSensors(){
     sensors.ice40_pac.refresh();       //refresh before reading values
-    hyperramAddUint32_t(runningTime());
-   	hyperramAddUint16_t(sensors.ice40_pac.getVoltageCH1Raw());
-    hyperramAddUint16_t(sensors.ice40_pac.getVoltageCH2Raw());
-    hyperramAddUint16_t(sensors.ice40_pac.getCurrentCH1Raw());
-    hyperramAddUint16_t(sensors.ice40_pac.getCurrentCH2Raw());
-    hyperramAddUint32_t(sensors.ice40_pac.getPowerCH1());
-    hyperramAddUint32_t(sensors.ice40_pac.getPowerCH2());
-	hyperramAddUint32_t(sensors.ice40_pac.getAccCurrentCH1());
-    hyperramAddUint32_t(sensors.ice40_pac.getAccCurrentCH2());
-    hyperramAddUint16_t(sensors.temp1.readTempRaw());
-    hyperramAddUint16_t(sensors.temp2.readTempRaw());
-    hyperramAddUint16_t(sensors.temp3.readTempRaw()); 
-}
-
-void UvVminPropExperiment::hyperramAddUint8_t(uint8_t data){
-    memory.hyperram[ramPos] = data;
-    ramPos++;
-}
-
-void UvVminPropExperiment::hyperramAddUint16_t(uint16_t data){
-    memory.hyperram[ramPos] = data >> 8;
-    ramPos++;
-	memory.hyperram[ramPos] = data & 0x00FF;
-    ramPos++;
-}
-
-void UvVminPropExperiment::hyperramAddUint32_t(uint32_t data){
-	hyperramAddUint16_t(data >> 16);
-	hyperramAddUint16_t(data & 0x0000FFFF);
+    record.begin(RECORD_SENSORS, runningTime());
+   	record.put16(sensors.ice40_pac.getVoltageCH1Raw());
+    record.put16(sensors.ice40_pac.getVoltageCH2Raw());
+    record.put16(sensors.ice40_pac.getCurrentCH1Raw());
+    record.put16(sensors.ice40_pac.getCurrentCH2Raw());
+    record.put32(sensors.ice40_pac.getPowerCH1());
+    record.put32(sensors.ice40_pac.getPowerCH2());
+	record.put32(sensors.ice40_pac.getAccCurrentCH1());
+    record.put32(sensors.ice40_pac.getAccCurrentCH2());
+    record.put16(sensors.temp1.readTempRaw());
+    record.put16(sensors.temp2.readTempRaw());
+    record.put16(sensors.temp3.readTempRaw()); 
+    record.end();
 }
\ No newline at end of file
@@ -68,6 +68,12 @@ COMMONFLAGS = $(DEPFLAGS) -O0 $(CPUFLAGS) -g3 -no-pie -fomit-frame-pointer -Wall
 ifeq ($(LTO), 1)
 COMMONFLAGS += -flto
 endif
+ifeq ($(LOG_BINARY), 1)
+COMMONFLAGS += -DLOG_BINARY=1
+endif
+ifeq ($(FLASH_BENCHMARK), 1)
+COMMONFLAGS += -DFLASH_BENCHMARK=1
+endif
 ifneq ($(CPUFAMILY), arm)
 COMMONFLAGS += -fexceptions
 endif
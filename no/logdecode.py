@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+#
+# Expands the binary log of the firmware (make LOG_BINARY=1) back to text.
+# The format strings are taken from the .logfmt section of the ELF that runs on the target,
+# see code/inc/logging.h for the record layout. Bytes that are no log record are passed through.
+#
+# Usage: ./logdecode.py demo.elf < capture.bin
+#        ./logdecode.py demo.elf /dev/ttyUSB0
+
+import argparse
+import re
+import struct
+import sys
+
+LOG_SYNC = 0xA5
+LOG_RECORD_HEADER = 4
+
+SPEC = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|z|j|t|L)?([diouxXeEfFgGaAcsp%])")
+
+def read_section(elf_path, name):
+	with open(elf_path, "rb") as f:
+		elf = f.read()
+
+	if elf[:4] != b"\x7fELF":
+		sys.exit("%s is no ELF file" % elf_path)
+
+	if elf[4] == 1:
+		shoff, = struct.unpack_from("<I", elf, 0x20)
+		shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+		header = "<IIIIIIIIII"
+	else:
+		shoff, = struct.unpack_from("<Q", elf, 0x28)
+		shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x3A)
+		header = "<IIQQQQIIQQ"
+
+	sections = [struct.unpack_from(header, elf, shoff + i * shentsize) for i in range(shnum)]
+	strtab = sections[shstrndx]
+
+	for section in sections:
+		end = elf.index(b"\0", strtab[4] + section[0])
+		if elf[strtab[4] + section[0]:end].decode() == name:
+			return section[3], elf[section[4]:section[4] + section[5]]
+
+	sys.exit("%s has no %s section, was it built with LOG_BINARY=1?" % (elf_path, name))
+
+def read_formats(elf_path):
+	""" Every entry is "LEVEL\\0file:line\\0format\\0", the ID is its address cut to 16 bit """
+	address, data = read_section(elf_path, ".logfmt")
+	if len(data) > 0x10000:
+		print("warning: .logfmt is larger than 64 KiB, IDs are ambiguous", file=sys.stderr)
+
+	formats = {}
+	pos = 0
+	while pos < len(data):
+		if data[pos] == 0:
+			pos += 1
+			continue
+
+		start = pos
+		fields = []
+		for _ in range(3):
+			end = data.index(b"\0", pos)
+			fields.append(data[pos:end].decode(errors="replace"))
+			pos = end + 1
+		formats[(address + start) & 0xFFFF] = fields
+
+	return formats
+
+def expand(fmt, payload):
+	""" Consumes the arguments in the sizes logPack() wrote them, None if the payload does not fit """
+	pos = 0
+	out = ""
+	last = 0
+
+	def take(size, code):
+		nonlocal pos
+		if pos + size > len(payload):
+			raise ValueError
+		value, = struct.unpack_from(code, payload, pos)
+		pos += size
+		return value
+
+	try:
+		for m in SPEC.finditer(fmt):
+			out += fmt[last:m.start()]
+			last = m.end()
+			flags, width, precision, length, conv = m.groups()
+
+			if conv == "%":
+				out += "%"
+				continue
+
+			if width == "*":
+				width = str(take(4, "<i"))
+			if precision == "*":
+				precision = str(take(4, "<i"))
+
+			spec = "%" + flags + (width or "") + ("." + precision if precision is not None else "")
+			wide = length in ("ll", "j")
+
+			if conv in "di":
+				out += (spec + "d") % (take(8, "<q") if wide else take(4, "<i"))
+			elif conv in "ouxX":
+				out += (spec + conv) % (take(8, "<Q") if wide else take(4, "<I"))
+			elif conv in "eEfFgGaA":
+				out += (spec + (conv if conv not in "aA" else "e")) % take(8, "<d")
+			elif conv == "c":
+				out += (spec + "c") % chr(take(4, "<I") & 0xFF)
+			elif conv == "p":
+				out += "0x%08x" % take(4, "<I")
+			elif conv == "s":
+				size = take(1, "<B")
+				if pos + size > len(payload):
+					raise ValueError
+				out += (spec + "s") % payload[pos:pos + size].decode(errors="replace")
+				pos += size
+	except ValueError:
+		return None
+
+	if pos != len(payload):
+		return None
+
+	return out + fmt[last:]
+
+def decode(stream, formats, out):
+	buffer = b""
+	while True:
+		chunk = getattr(stream, "read1", stream.read)(4096)
+		if not chunk:
+			break
+		buffer += chunk
+
+		while buffer:
+			if buffer[0] != LOG_SYNC:
+				# Plain text from print() and everything else on the UART
+				end = buffer.find(bytes([LOG_SYNC]))
+				end = len(buffer) if end < 0 else end
+				out.write(buffer[:end].decode(errors="replace"))
+				buffer = buffer[end:]
+				continue
+
+			if len(buffer) < LOG_RECORD_HEADER:
+				break
+
+			record_id, length = struct.unpack_from("<HB", buffer, 1)
+			if len(buffer) < LOG_RECORD_HEADER + length:
+				break
+
+			entry = formats.get(record_id)
+			message = expand(entry[2], buffer[LOG_RECORD_HEADER:LOG_RECORD_HEADER + length]) if entry else None
+			if message is None:
+				out.write(buffer[:1].decode(errors="replace"))
+				buffer = buffer[1:]
+				continue
+
+			out.write("[%s] %s: %s\n" % (entry[0], entry[1], message.rstrip("\n")))
+			buffer = buffer[LOG_RECORD_HEADER + length:]
+
+		out.flush()
+
+	out.write(buffer.decode(errors="replace"))
+
+if __name__ == "__main__":
+	parser = argparse.ArgumentParser(description="Expands the binary log of the firmware")
+	parser.add_argument("elf", help="ELF the target runs, e.g. demo.elf")
+	parser.add_argument("input", nargs="?", default="-", help="captured log or serial device, - for stdin")
+	parser.add_argument("--list", action="store_true", help="print all known IDs and their format strings")
+	args = parser.parse_args()
+
+	formats = read_formats(args.elf)
+
+	if args.list:
+		for record_id, (level, location, fmt) in sorted(formats.items()):
+			print("0x%04x [%s] %s: %s" % (record_id, level, location, fmt.rstrip("\n")))
+		sys.exit(0)
+
+	stream = sys.stdin.buffer if args.input == "-" else open(args.input, "rb", buffering=0)
+	decode(stream, formats, sys.stdout)
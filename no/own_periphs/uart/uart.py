@@ -38,19 +38,23 @@ class CustomUart(LiteXModule):
 		])
 		
 		dout_vld_sig = Signal()
+		din_rdy_sig = Signal()
 
 		rx_data_raw = Signal(8)
 		rx_data_buffer = Signal(8)
 		self.sync += If(dout_vld_sig, rx_data_buffer.eq(rx_data_raw))
 		self.comb += self.rx_data.status.eq(rx_data_buffer)
 
-		# Setup an Interrupt for when input data is received
+		# Setup an Interrupt for when input data is received and when the transmitter can take the next byte
 		self.submodules.ev = EventManager()
 		self.ev.rx = EventSourceProcess(edge="rising")
+		self.ev.tx = EventSourceProcess(edge="rising")
 		self.ev.finalize()
 
 		self.comb += self.ev.rx.trigger.eq(dout_vld_sig == 1)
+		self.comb += self.ev.tx.trigger.eq(din_rdy_sig == 1)
 		self.comb += self.status.fields.DOUT_VLD.eq(dout_vld_sig)
+		self.comb += self.status.fields.DIN_RDY.eq(din_rdy_sig)
 
 		verilog_path = os.path.abspath(os.path.dirname(__file__)) + "/UART.v"
 
@@ -70,7 +74,7 @@ class CustomUart(LiteXModule):
 
 				i_DIN = self.tx_data.storage,
 				i_DIN_VLD = self.control.fields.DIN_VLD, 
-				o_DIN_RDY = self.status.fields.DIN_RDY,
+				o_DIN_RDY = din_rdy_sig,
 
 				o_DOUT = rx_data_raw,
 				o_DOUT_VLD = dout_vld_sig,
@@ -98,7 +102,7 @@ class CustomUart(LiteXModule):
 
 				i_DIN = self.tx_data.storage,
 				i_DIN_VLD = self.control.fields.DIN_VLD, 
-				o_DIN_RDY = self.status.fields.DIN_RDY,
+				o_DIN_RDY = din_rdy_sig,
 
 				o_DOUT = rx_data_raw,
 				o_DOUT_VLD = dout_vld_sig,
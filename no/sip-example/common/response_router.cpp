@@ -0,0 +1,78 @@
+/*
+ * Routes the responses of the payload to the Coordinator or to the stream queue, see response_router.h.
+ */
+
+#include "response_router.h"
+
+#include <outpost/sip/packet/packet_reader.h>
+
+#include <stdio.h>
+
+ResponseRouter::ResponseRouter(outpost::sip::PacketTransport& packetTransport, outpost::sip::Coordinator& coordinator, RequestTracker& requests) :
+	outpost::rtos::Thread(1U, outpost::rtos::Thread::defaultStackSize, "Router"),
+	mPacketTransport(packetTransport),
+	mCoordinator(coordinator),
+	mRequests(requests),
+	mStreamQueue(streamQueueSize),
+	mStreaming(false),
+	mBuffer{}
+{
+}
+
+void
+ResponseRouter::startStream()
+{
+	mStreaming = true;
+
+	outpost::sip::Coordinator::ResponseData data;
+	while(mStreamQueue.receive(data, outpost::time::Duration::zero()))
+	{
+	}
+}
+
+void
+ResponseRouter::run()
+{
+	while(1)
+	{
+		outpost::Slice<uint8_t> bufferToRead(mBuffer);
+		if(!mPacketTransport.receive(bufferToRead, outpost::time::Seconds(1)))
+		{
+			continue;
+		}
+
+		outpost::sip::PacketReader packetReader(bufferToRead);
+		if(packetReader.readPacket() != outpost::sip::OperationResult::success)
+		{
+			continue;
+		}
+
+		outpost::sip::Coordinator::ResponseData data;
+		data.length = packetReader.getLength();
+		data.workerId = packetReader.getWorkerId();
+		data.counter = packetReader.getCounter();
+		data.type = packetReader.getType();
+
+		outpost::Slice<const uint8_t> payloadData(packetReader.getPayloadData());
+		data.payloadDataLength = payloadData.getNumberOfElements();
+		if(payloadData.getNumberOfElements() > 0)
+		{
+			outpost::Slice<uint8_t> dataPayloadSlice(data.payloadData);
+			dataPayloadSlice.copyFrom(payloadData);
+		}
+
+		/* Late bulk frames never belong to the Coordinator */
+		if(mStreaming || data.type == bulkResponseType)
+		{
+			mStreamQueue.send(data);
+		}
+		else if(mRequests.answersRequest(data.counter))
+		{
+			mCoordinator.sendResponseQueue(data);
+		}
+		else
+		{
+			printf("Dropped response %u of type 0x%X, it doesnt answer the current request\n", data.counter, data.type);
+		}
+	}
+}
@@ -0,0 +1,98 @@
+/*
+ * Response handling shared by the sip-coordinator and the sip-uploader.
+ */
+
+#ifndef RESPONSE_ROUTER_H_
+#define RESPONSE_ROUTER_H_
+
+#include <atomic>
+
+#include <outpost/rtos/queue.h>
+#include <outpost/rtos/thread.h>
+#include <outpost/sip/coordinator/coordinator.h>
+#include <outpost/sip/packet/packet_reader.h>
+#include <outpost/sip/packet_transport/packet_transport.h>
+
+/*
+ * Sits between the Coordinator and the transport and keeps the counter of the last request,
+ * so a late response to an earlier request is not taken as the answer to the current one.
+ */
+class RequestTracker : public outpost::sip::PacketTransport
+{
+public:
+	explicit RequestTracker(outpost::sip::PacketTransport& packetTransport) :
+		mPacketTransport(packetTransport),
+		mCounter(0)
+	{
+	}
+
+	outpost::Expected<size_t, outpost::sip::OperationResult>
+	transmit(outpost::sip::PacketReader const& packet) override
+	{
+		/* Before sending, the response may come back right away */
+		mCounter = packet.getCounter();
+		return mPacketTransport.transmit(packet);
+	}
+
+	outpost::Expected<outpost::sip::PacketReader, outpost::sip::OperationResult>
+	receive(outpost::Slice<uint8_t> const& writeBuffer, outpost::time::Duration timeout) override
+	{
+		return mPacketTransport.receive(writeBuffer, timeout);
+	}
+
+	bool
+	answersRequest(uint8_t counter) const
+	{
+		return counter == mCounter;
+	}
+
+private:
+	outpost::sip::PacketTransport& mPacketTransport;
+	std::atomic<uint8_t> mCounter;
+};
+
+/*
+ * Replaces the CoordinatorPacketReceiver. The Coordinator only holds a single
+ * response, bulk reads and pipelined writes get many responses per request.
+ * While such a transfer runs, all responses go to a queue of their own,
+ * otherwise they are handed to the Coordinator if they carry the counter of its last request.
+ */
+class ResponseRouter : public outpost::rtos::Thread
+{
+public:
+	static constexpr uint8_t bulkResponseType = 0x0F;
+	static constexpr size_t streamQueueSize = 128;
+
+	ResponseRouter(outpost::sip::PacketTransport& packetTransport, outpost::sip::Coordinator& coordinator, RequestTracker& requests);
+
+	/*
+	 * Starts routing all responses to the stream queue, drops everything left over from an earlier transfer.
+	 */
+	void
+	startStream();
+
+	void
+	stopStream()
+	{
+		mStreaming = false;
+	}
+
+	bool
+	receiveStream(outpost::sip::Coordinator::ResponseData& data, outpost::time::Duration timeout)
+	{
+		return mStreamQueue.receive(data, timeout);
+	}
+
+private:
+	void
+	run() override;
+
+	outpost::sip::PacketTransport& mPacketTransport;
+	outpost::sip::Coordinator& mCoordinator;
+	RequestTracker& mRequests;
+	outpost::rtos::Queue<outpost::sip::Coordinator::ResponseData> mStreamQueue;
+	std::atomic<bool> mStreaming;
+	uint8_t mBuffer[outpost::sip::parameter::maxPacketLength];
+};
+
+#endif // RESPONSE_ROUTER_H_
@@ -0,0 +1,149 @@
+/*
+ * Transfers of the sip-coordinator and the sip-uploader that keep several requests in flight.
+ */
+
+#include "sip_transfer.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <deque>
+
+#include <outpost/sip/packet/packet_writer.h>
+
+bool
+sendPacket(outpost::sip::PacketTransport& transport, uint8_t packet_counter, uint8_t type, outpost::Slice<const uint8_t> payload)
+{
+	std::array<uint8_t, outpost::sip::parameter::maxPacketLength> buffer;
+	outpost::sip::PacketWriter packetWriter(outpost::asSlice(buffer));
+
+	packetWriter.setWorkerId(0x01);
+	packetWriter.setCounter(packet_counter);
+	packetWriter.setType(type);
+	packetWriter.setPayloadData(payload);
+
+	auto const packet = packetWriter.getReader();
+	return packet && transport.transmit(*packet);
+}
+
+uint32_t
+readLe(const uint8_t* bytes, uint8_t count)
+{
+	uint32_t value = 0;
+	for(uint8_t i = 0; i < count; i++)
+	{
+		value |= static_cast<uint32_t>(bytes[i]) << (8 * i);
+	}
+	return value;
+}
+
+uint32_t
+sendAllDataPipelined(ResponseRouter& router, outpost::sip::PacketTransport& transport, uint8_t& counter,
+		const std::vector<uint8_t>& data, uint8_t window)
+{
+	/* Length and offset in front of the data */
+	const uint16_t chunk_header = 5;
+	const uint16_t chunk_size = outpost::sip::parameter::maxPayloadLength - chunk_header;
+	/* Timeouts in a row without progress before giving up */
+	const uint32_t stall_max = 5;
+
+	struct Chunk
+	{
+		uint8_t counter;
+		uint32_t offset;
+		uint32_t len;
+	};
+
+	std::deque<Chunk> in_flight;
+	outpost::sip::Coordinator::ResponseData response;
+	uint32_t acked = 0;
+	uint32_t next = 0;
+	uint32_t sent_max = 0;
+	uint32_t resent = 0;
+	uint32_t stalls = 0;
+
+	printf("Sending %zu Bytes in chunks of %u, %u in flight\n", data.size(), chunk_size, window);
+
+	router.startStream();
+	auto start = std::chrono::steady_clock::now();
+
+	while(acked < data.size())
+	{
+		/* Keep the window full, the payload programs while the next chunks arrive */
+		while(in_flight.size() < window && next < data.size())
+		{
+			uint32_t len = std::min<uint32_t>(chunk_size, data.size() - next);
+			std::vector<uint8_t> chunk =
+			{
+				static_cast<uint8_t>(len), static_cast<uint8_t>(len >> 8),
+				static_cast<uint8_t>(next), static_cast<uint8_t>(next >> 8), static_cast<uint8_t>(next >> 16),
+			};
+			chunk.insert(chunk.end(), data.begin() + next, data.begin() + next + len);
+
+			uint8_t chunk_counter = counter++;
+			sendPacket(transport, chunk_counter, 0x06, outpost::asSlice(chunk));
+			in_flight.push_back({chunk_counter, next, len});
+
+			resent += (next < sent_max) ? len : 0;
+			next += len;
+			sent_max = std::max(sent_max, next);
+		}
+
+		if(!router.receiveStream(response, outpost::time::Seconds(1)))
+		{
+			if(++stalls >= stall_max)
+			{
+				printf("Upload stalled at %u of %zu Bytes\n", acked, data.size());
+				break;
+			}
+
+			/* No ACK came back, everything after the acked offset goes out again */
+			in_flight.clear();
+			next = acked;
+			continue;
+		}
+
+		if(response.type != 0x08)
+		{
+			continue;
+		}
+
+		if(response.payloadData[0] != 1 || response.payloadDataLength < 4)
+		{
+			printf("Got NACK at %u of %zu Bytes\n", acked, data.size());
+			break;
+		}
+
+		/* The ACK carries how many Bytes were written in a row so far */
+		uint32_t progress = readLe(&response.payloadData[1], 3);
+		if(progress > acked)
+		{
+			acked = progress;
+			stalls = 0;
+		}
+
+		auto chunk = std::find_if(in_flight.begin(), in_flight.end(),
+			[&response](const Chunk& c) { return c.counter == response.counter; });
+		if(chunk != in_flight.end() && progress < chunk->offset + chunk->len)
+		{
+			/* The payload skipped this chunk, so one before it got lost, go back */
+			in_flight.clear();
+			next = acked;
+			continue;
+		}
+
+		while(!in_flight.empty() && in_flight.front().offset + in_flight.front().len <= acked)
+		{
+			in_flight.pop_front();
+		}
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	router.stopStream();
+
+	printf("Written %u Bytes in %.2f s, %.1f KiB/s, %u Bytes sent again\n",
+		acked, elapsed.count(), acked / 1024.0 / elapsed.count(), resent);
+
+	return acked;
+}
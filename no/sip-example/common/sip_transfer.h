@@ -0,0 +1,40 @@
+/*
+ * Transfers of the sip-coordinator and the sip-uploader that keep several requests in flight.
+ */
+
+#ifndef SIP_TRANSFER_H_
+#define SIP_TRANSFER_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include <outpost/base/slice.h>
+#include <outpost/sip/packet_transport/packet_transport.h>
+
+#include "response_router.h"
+
+/*
+ * Sends a request to worker 0x01 without waiting for its response, the responses are
+ * picked up through the ResponseRouter.
+ */
+bool
+sendPacket(outpost::sip::PacketTransport& transport, uint8_t packet_counter, uint8_t type, outpost::Slice<const uint8_t> payload);
+
+/*
+ * Reads count Bytes as little endian value.
+ */
+uint32_t
+readLe(const uint8_t* bytes, uint8_t count);
+
+/*
+ * Sends data as MEMORY_WRITE_DATA chunks in pipelined mode (see MemoryWriteHandler), with up to window
+ * chunks in flight. The ACKs are cumulative, after a gap everything behind the acked offset is sent again.
+ * MEMORY_WRITE_INIT has to be sent before, counter is advanced for every chunk.
+ *
+ * Returns the amount of Bytes that have been acked.
+ */
+uint32_t
+sendAllDataPipelined(ResponseRouter& router, outpost::sip::PacketTransport& transport, uint8_t& counter,
+		const std::vector<uint8_t>& data, uint8_t window);
+
+#endif // SIP_TRANSFER_H_
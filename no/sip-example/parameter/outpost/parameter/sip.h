@@ -0,0 +1,54 @@
+/*
+ * SIP parameters of the sip-example tools, used instead of the defaults in
+ * ext/outpost-core/modules/sip/default (see SConscript.common).
+ */
+
+#ifndef OUTPOST_SIP_PARAMETER_SIP_H_
+#define OUTPOST_SIP_PARAMETER_SIP_H_
+
+#include <outpost/sip/constants.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <type_traits>
+
+namespace outpost
+{
+namespace sip
+{
+namespace parameter
+{
+/* Same as the command buffer of the payload, so MEMORY_WRITE_DATA chunks and bulk read frames can use all of it */
+static constexpr uint16_t maxPayloadLength = 1024;
+static constexpr size_t maxPacketLength = maxPayloadLength + constants::packetOverhead;
+static_assert(constants::maxPayloadLengthProtocolLimit >= maxPayloadLength,
+              "The 2-Byte length field counts the Payload with remaining Header and CRC."
+              "The current length does not fit in 2 Bytes."
+              "Adjust maxPayloadLength accordingly.");
+
+enum class defaultRequestType : uint8_t
+{
+    linkTest = 0x01,
+    hkRequest = 0x02
+    /* 0x02-0x0f reserved */
+    /* ======================================= */
+    /* 0x10-0x7f application specific requests */
+};
+
+enum class defaultResponseType : uint8_t
+{
+    framingErorr = 0x80,
+    errorAck = 0x81,
+    successAck = 0x82,
+    hkResponse = 0x83
+    /* 0x84-0x8f reserved */
+    /* ======================================= */
+    /* 0x90-0xff application specific response */
+};
+
+}  // namespace parameter
+}  // namespace sip
+}  // namespace outpost
+
+#endif /* OUTPOST_SIP_PARAMETER_SIP_H_ */
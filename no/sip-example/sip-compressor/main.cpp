@@ -0,0 +1,198 @@
+/*
+ * Compresses ICE40 Bitstreams into the format of code/inc/bitstreamcodec.h,
+ * the output can be uploaded with the sip-uploader like a raw image.
+ */
+
+#include <popl.hpp>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <random>
+
+#include <stdio.h>
+
+#include <iostream>
+
+#include "bitstreamcodec.h"
+
+std::vector<uint8_t> compress(const std::vector<uint8_t> &data);
+template<uint32_t CHUNK_SIZE>
+bool decompress(const std::vector<uint8_t> &image, std::vector<uint8_t> &data);
+bool roundTrip(const std::vector<uint8_t> &data, const char* name);
+bool selfTest();
+
+int main(int argc, char** argv)
+{
+	popl::OptionParser op("Allowed options");
+	auto help_option = op.add<popl::Switch>("h", "help", "produce help message");
+	auto input = op.add<popl::Value<std::string>>("i", "input", "raw Bitstream");
+	auto output = op.add<popl::Value<std::string>>("o", "output", "compressed image");
+	auto verify_option = op.add<popl::Switch>("v", "verify", "decompress the output again and compare it");
+	auto test_option = op.add<popl::Switch>("t", "selftest", "round trip a set of generated patterns");
+	try
+	{
+		op.parse(argc, argv);
+
+		if (help_option->count() == 1)
+		{
+			printf("%s", op.help().c_str());
+			return 0;
+		}
+
+		if (test_option->count() == 1)
+		{
+			return selfTest() ? 0 : 1;
+		}
+
+		if (!input->is_set() || !output->is_set())
+		{
+			printf("%s", op.help().c_str());
+			return 1;
+		}
+
+		std::ifstream fin(input->value(), std::ios::binary);
+		if (!fin)
+		{
+			std::cerr << "Error opening file: " << input->value() << std::endl;
+			return 1;
+		}
+		std::vector<uint8_t> filebytes((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+		fin.close();
+
+		std::vector<uint8_t> image = compress(filebytes);
+
+		std::ofstream fout(output->value(), std::ios::binary);
+		fout.write(reinterpret_cast<const char*>(image.data()), image.size());
+		fout.close();
+
+		printf("%zu -> %zu bytes (%.1f%%)\n", filebytes.size(), image.size(),
+			filebytes.empty() ? 0.0 : 100.0 * image.size() / filebytes.size());
+
+		if (verify_option->count() == 1 && !roundTrip(filebytes, input->value().c_str()))
+		{
+			return 1;
+		}
+	}
+	catch (std::exception& e)
+	{
+		printf("Failed: %s\r\n", e.what());
+		return 1;
+	}
+
+	return 0;
+}
+
+std::vector<uint8_t> compress(const std::vector<uint8_t> &data)
+{
+	std::vector<uint8_t> image(BitstreamCodec::maxEncodedSize(data.size()));
+	uint32_t size = BitstreamCodec::encode(data.data(), data.size(), image.data());
+	image.resize(size);
+
+	return image;
+}
+
+/*
+ * Stands in for the flash and the ICE40 SPI, so the firmware loop of BitstreamDecoder::stream() runs unchanged
+ */
+struct ImagePort
+{
+	const std::vector<uint8_t> &image;
+	std::vector<uint8_t> &data;
+
+	void read(uint32_t offset, uint8_t* dst, uint32_t len)
+	{
+		std::copy(image.begin() + offset, image.begin() + offset + len, dst);
+	}
+
+	void readWhileWriting(uint32_t offset, uint8_t* dst, uint32_t len, const uint8_t* src, uint32_t src_len)
+	{
+		data.insert(data.end(), src, src + src_len);
+		read(offset, dst, len);
+	}
+};
+
+template<uint32_t CHUNK_SIZE>
+bool decompress(const std::vector<uint8_t> &image, std::vector<uint8_t> &data)
+{
+	/* Too big for the stack with its window */
+	static BitstreamDecoder decoder;
+	ImagePort port = {image, data};
+	uint32_t read_end;
+
+	data.clear();
+	return decoder.stream<CHUNK_SIZE>(port, image.size(), read_end) == STREAM_OK && read_end == image.size();
+}
+
+bool roundTrip(const std::vector<uint8_t> &data, const char* name)
+{
+	std::vector<uint8_t> image = compress(data);
+
+	/* 256 is the chunk size of the firmware */
+	bool (*decoders[])(const std::vector<uint8_t>&, std::vector<uint8_t>&) =
+	{
+		decompress<1>, decompress<7>, decompress<256>, decompress<4096>,
+	};
+	uint32_t chunk_sizes[] = {1, 7, 256, 4096};
+
+	for (size_t i = 0; i < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); i++)
+	{
+		std::vector<uint8_t> decoded;
+		if (!decoders[i](image, decoded) || decoded != data)
+		{
+			printf("FAIL %s (%zu bytes, chunk size %u)\n", name, data.size(), chunk_sizes[i]);
+			return false;
+		}
+	}
+
+	printf("OK   %s: %zu -> %zu bytes\n", name, data.size(), image.size());
+	return true;
+}
+
+bool selfTest()
+{
+	std::mt19937 rng(1);
+	bool result = true;
+
+	std::vector<uint8_t> empty;
+	result &= roundTrip(empty, "empty");
+
+	std::vector<uint8_t> zeroes(104090, 0);
+	result &= roundTrip(zeroes, "zeroes, longer than one run");
+
+	std::vector<uint8_t> random(20000);
+	for (auto& b : random) b = rng();
+	result &= roundTrip(random, "random");
+
+	/* Images that end in a run, the decoder still has output pending after the last input */
+	std::vector<uint8_t> short_zeroes(5000, 0);
+	result &= roundTrip(short_zeroes, "zeroes, ending in a run");
+
+	std::vector<uint8_t> random_then_zeroes(random.begin(), random.begin() + 3000);
+	random_then_zeroes.insert(random_then_zeroes.end(), 1000, 0);
+	result &= roundTrip(random_then_zeroes, "random, ending in a run");
+
+	std::vector<uint8_t> pattern;
+	for (uint32_t i = 0; i < 30000; i++) pattern.push_back("RISA-PAYLOAD"[i % 12]);
+	result &= roundTrip(pattern, "repeated pattern");
+
+	/* Sparse like a Bitstream, long zero runs with short random frames in between */
+	std::vector<uint8_t> sparse;
+	for (uint32_t frame = 0; frame < 400; frame++)
+	{
+		sparse.insert(sparse.end(), rng() % 600, 0);
+		for (uint32_t i = rng() % 40; i > 0; i--) sparse.push_back(rng());
+		sparse.insert(sparse.end(), rng() % 5, 0xFF);
+	}
+	result &= roundTrip(sparse, "sparse");
+
+	/* Back references right at the window border */
+	std::vector<uint8_t> window(CODEC_WINDOW_SIZE);
+	for (auto& b : window) b = rng();
+	std::vector<uint8_t> border = window;
+	border.insert(border.end(), window.begin(), window.end());
+	border.insert(border.end(), window.begin() + 1, window.end());
+	result &= roundTrip(border, "window border");
+
+	printf(result ? "All round trips passed\n" : "Round trip FAILED\n");
+	return result;
+}
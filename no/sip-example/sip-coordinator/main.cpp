@@ -28,7 +28,11 @@
 #include <outpost/rtos/clock.h>
 
 #include <stdio.h>
+#include <chrono>
+#include <fstream>
 #include "arr.h"
+#include "response_router.h"
+#include "sip_transfer.h"
 
 #include <iostream>
 
@@ -44,8 +48,10 @@ outpost::transport::BufferedFrameDecoderHdlc frameDecoderHdlc(outpost::asSlice(r
 outpost::transport::FrameTransportSerial frameTransportSerial(systemClock, sipPort, frameEncoderHdlc, outpost::asSlice(transmitBuffer), frameDecoderHdlc);
 outpost::sip::PacketTransportWrapper packetTransportWrapper(frameTransportSerial);
 
-outpost::sip::Coordinator sipCoordinator(packetTransportWrapper);
-outpost::sip::CoordinatorPacketReceiver sipReceiver(packetTransportWrapper, sipCoordinator, outpost::support::parameter::HeartbeatSource::default0, 1U);
+/* Requests of the Coordinator go through the tracker, so only responses to the last one reach it */
+RequestTracker requestTracker(packetTransportWrapper);
+outpost::sip::Coordinator sipCoordinator(requestTracker);
+ResponseRouter responseRouter(packetTransportWrapper, sipCoordinator, requestTracker);
 
 uint8_t responseData[4096];
 outpost::Slice<uint8_t> responseSlice(responseData);
@@ -70,6 +76,7 @@ std::vector<std::string> split(std::string s, std::string delimiter)
 void startDataWrite(std::vector<uint8_t> &data, uint32_t address, bool write_flash);
 void sendAllData(std::vector<uint8_t> &data);
 std::vector<uint8_t> dumpData(uint32_t address, bool write_flash, uint32_t len);
+std::vector<uint8_t> bulkRead(uint8_t source, uint32_t address, uint32_t len, uint8_t window, uint8_t test_id);
 uint8_t counter = 0;
 
 int main(int argc, char** argv)
@@ -111,7 +118,7 @@ int main(int argc, char** argv)
 
 		sipPort.open(port->value(), baud->value(), p);
 
-		sipReceiver.start();
+		responseRouter.start();
 
 		while (1)
 		{
@@ -313,6 +320,71 @@ int main(int argc, char** argv)
 
 					dumpData(0, false, 50);
 				}
+				else if(input == "bulkread")
+				{
+					/* bulkread <ram|flash|test> <address|experiment> <length> [window] [file] */
+					if(args.size() < 3)
+					{
+						printf("Usage: bulkread <ram|flash|test> <address|experiment> <length> [window] [file]\n");
+						continue;
+					}
+
+					uint8_t source = (args[0] == "flash") ? 1 : (args[0] == "test") ? 2 : 0;
+					uint32_t address = std::stoul(args[1], nullptr, 0);
+					uint32_t len = std::stoul(args[2], nullptr, 0);
+					uint8_t window = (args.size() > 3) ? std::stoul(args[3]) : 16;
+
+					std::vector<uint8_t> data = bulkRead(source, (source == 2) ? 0 : address, len, window, (source == 2) ? address : 0);
+
+					if(args.size() > 4 && !data.empty())
+					{
+						std::ofstream file(args[4], std::ios::binary);
+						file.write(reinterpret_cast<const char*>(data.data()), data.size());
+						printf("Written to %s\n", args[4].c_str());
+					}
+				}
+				else if(input == "loglevel")
+				{
+					/* loglevel <module|all> <level>, levels: 0 off, 1 warn, 2 test, 3 info */
+					if(args.size() < 2)
+					{
+						printf("Usage: loglevel <module|all> <level>\n");
+						continue;
+					}
+
+					uint8_t payload[] = 
+					{
+						static_cast<uint8_t>(args[0] == "all" ? 0xFF : std::stoul(args[0])),
+						static_cast<uint8_t>(std::stoul(args[1])),
+					};
+
+					res = sipCoordinator.sendRequestGetResponseData(
+						0x01, // target worker id
+						counter++, // message counter
+						0x10, // type
+						0x08, // expected response type
+						outpost::asSlice(payload),
+						responseSlice
+						);
+
+					if(outpost::sip::OperationResult::success == res)
+					{
+						if(responseData[0] == 1)
+						{
+							/* core, sip, memory, sensors, riscv, uvvmin, isfd, ice40flash */
+							printf("Got ACK, levels:");
+							for(size_t i = 1; i < 9; i++)
+							{
+								printf(" %d", responseData[i]);
+							}
+							printf("\n");
+						}
+						else
+						{
+							printf("Got NACK\n");
+						}
+					}
+				}
 
 				switch(res)
 				{
@@ -394,8 +466,10 @@ void startDataWrite(std::vector<uint8_t> &data, uint32_t address, bool write_fla
 		return;
 	}
 
+	/* No verify, pipelined */
 	uint8_t payload[] = {write_flash, static_cast<uint8_t>((address & 0xFF)), static_cast<uint8_t>((address >> 8)), 
-	static_cast<uint8_t>((address >> 16)), static_cast<uint8_t>(data.size()), static_cast<uint8_t>((data.size() >> 8))};
+	static_cast<uint8_t>((address >> 16)), static_cast<uint8_t>(data.size()), static_cast<uint8_t>((data.size() >> 8)), static_cast<uint8_t>((data.size() >> 16)),
+	0, 1};
 	printf("INIT with len %d\n", data.size());
 	//send your request here
 	res = sipCoordinator.sendRequestGetResponseData(
@@ -427,120 +501,143 @@ void startDataWrite(std::vector<uint8_t> &data, uint32_t address, bool write_fla
 
 void sendAllData(std::vector<uint8_t> &data)
 {
-	outpost::sip::OperationResult res;
-	const uint16_t max_per_package = 250;
-	uint32_t num_packages = data.size() / max_per_package;
-	uint32_t leftover_bytes = data.size() % max_per_package;
-	uint32_t write_index = 0;
-
-	printf("packages: %d, leftover: %d\n", num_packages, leftover_bytes);
-	
-	for(uint32_t i = 0; i < num_packages; i++)
+	/* Chunks in flight without an ACK */
+	sendAllDataPipelined(responseRouter, packetTransportWrapper, counter, data, 4);
+}
+
+std::vector<uint8_t> bulkRead(uint8_t source, uint32_t address, uint32_t len, uint8_t window, uint8_t test_id)
+{
+	/* Frame number in front of the data */
+	const uint16_t frame_header = 4;
+	const uint16_t frame_size = outpost::sip::parameter::maxPayloadLength - frame_header;
+	/* Frame numbers that fit into one BULK_CONTINUE */
+	const size_t missing_max = outpost::sip::parameter::maxPayloadLength / 4;
+	/* Rounds without a single frame before giving up */
+	const uint32_t stall_max = 5;
+
+	std::vector<uint8_t> data;
+	outpost::sip::Coordinator::ResponseData response;
+	uint8_t bulk_counter = counter++;
+
+	responseRouter.startStream();
+
+	uint8_t payload[] =
+	{
+		source,
+		static_cast<uint8_t>(address), static_cast<uint8_t>(address >> 8), static_cast<uint8_t>(address >> 16),
+		static_cast<uint8_t>(len), static_cast<uint8_t>(len >> 8), static_cast<uint8_t>(len >> 16), static_cast<uint8_t>(len >> 24),
+		static_cast<uint8_t>(frame_size), static_cast<uint8_t>(frame_size >> 8),
+		window,
+		test_id,
+	};
+
+	auto start = std::chrono::steady_clock::now();
+
+	if(!sendPacket(packetTransportWrapper, bulk_counter, 0x11, outpost::asSlice(payload))
+		|| !responseRouter.receiveStream(response, outpost::time::Seconds(2))
+		|| response.type != 0x08 || response.payloadData[0] != 1 || response.payloadDataLength < 9)
 	{
-		std::vector<uint8_t> cur_vector;
-		cur_vector.push_back(max_per_package & 0xFF);
-		cur_vector.push_back((max_per_package >> 8) & 0xFF);
+		printf("Bulk read was not accepted\n");
+		responseRouter.stopStream();
+		return data;
+	}
 
-		for(uint32_t j = 0; j < max_per_package; j++)
-		{
-			cur_vector.push_back(data[write_index++]);
-		}
+	uint32_t frame_count = readLe(&response.payloadData[1], 4);
+	uint32_t length = readLe(&response.payloadData[5], 3);
+	window = response.payloadData[8];
+	printf("Reading %u Bytes in %u frames, window %u\n", length, frame_count, window);
 
-		printf("Sending request with cur_vector size %d\n", cur_vector.size());
-		//send your request here
-		res = sipCoordinator.sendRequestGetResponseData(
-			0x01, // target worker id
-			counter++, // message counter
-			0x06, // type
-			0x08, // expected response type
-			outpost::asSlice(cur_vector),
-			responseSlice
-		);
+	data.resize(length);
+	std::vector<bool> received(frame_count, false);
+	uint32_t received_count = 0;
+	uint32_t resent_count = 0;
+	uint32_t rounds = 1;
+	uint32_t stalls = 0;
+
+	/* The frames the worker sent so far, the first window follows the ACK right away */
+	uint32_t next_new = std::min<uint32_t>(window, frame_count);
+	uint32_t expected = next_new;
 
-		if(outpost::sip::OperationResult::success == res)
+	while(received_count < frame_count)
+	{
+		uint32_t got = 0;
+		while(got < expected && responseRouter.receiveStream(response, outpost::time::Milliseconds(500)))
 		{
-			if(responseData[0] == 1)
+			if(response.type == 0x08)
+			{
+				/* Only a NACK shows up here, the transfer was dropped by the worker */
+				printf("Bulk read aborted by the worker\n");
+				responseRouter.stopStream();
+				data.clear();
+				return data;
+			}
+
+			if(response.type != ResponseRouter::bulkResponseType || response.payloadDataLength < frame_header)
 			{
-				printf("Got ACK\n");
+				continue;
 			}
-			else
+
+			got++;
+			uint32_t frame = readLe(response.payloadData.data(), 4);
+			if(frame >= frame_count || received[frame]
+				|| frame * frame_size + response.payloadDataLength - frame_header > length)
 			{
-				printf("Got NACK\n");
+				continue;
 			}
+
+			std::copy(response.payloadData.begin() + frame_header, response.payloadData.begin() + response.payloadDataLength,
+				data.begin() + frame * frame_size);
+			received[frame] = true;
+			received_count++;
 		}
 
-		switch(res)
+		if(received_count == frame_count)
 		{
-		case outpost::sip::OperationResult::transmitError:
-			printf("Error on transmit.\r\n");
-			break;
-		case outpost::sip::OperationResult::responseError:
-			printf("Response timeout\r\n");
-			break;
-		case outpost::sip::OperationResult::workerIdError:
-			printf("Wrong worker id\r\n");
-			break;
-		case outpost::sip::OperationResult::responseTypeError:
-			printf("Wrong response type id\r\n");
-			break;
-		case outpost::sip::OperationResult::success:
-		default:
 			break;
 		}
-	}
-
-	if(!leftover_bytes)
-	{
-		return;
-	}
-
-	std::vector<uint8_t> cur_vector;
-	cur_vector.push_back(leftover_bytes);
-	cur_vector.push_back(0);
-
-	for(uint32_t i = 0; i < leftover_bytes; i++)
-	{
-		cur_vector.push_back(data[write_index++]);
-	}
-
-	//send your request here
-	res = sipCoordinator.sendRequestGetResponseData(
-		0x01, // target worker id
-		counter++, // message counter
-		0x06, // type
-		0x08, // expected response type
-		outpost::asSlice(cur_vector),
-		responseSlice
-	);
 
-	if(outpost::sip::OperationResult::success == res)
-	{
-		if(responseData[0] == 1)
+		stalls = got ? 0 : stalls + 1;
+		if(stalls >= stall_max)
 		{
-			printf("Got ACK\n");
+			printf("Bulk read stalled with %u of %u frames\n", received_count, frame_count);
+			responseRouter.stopStream();
+			data.clear();
+			return data;
 		}
-		else
+
+		/* Everything sent but not received is asked for again, at most a window of it */
+		std::vector<uint8_t> missing;
+		uint32_t missing_count = 0;
+		for(uint32_t frame = 0; frame < next_new && missing_count < std::min<uint32_t>(window, missing_max); frame++)
 		{
-			printf("Got NACK\n");
+			if(!received[frame])
+			{
+				for(uint8_t i = 0; i < 4; i++)
+				{
+					missing.push_back(frame >> (8 * i));
+				}
+				missing_count++;
+			}
 		}
-	}
 
-	switch(res)
-	{
-	case outpost::sip::OperationResult::transmitError:
-		printf("Error on transmit.\r\n");
-		break;
-	case outpost::sip::OperationResult::responseError:
-		printf("Response timeout\r\n");
-		break;
-	case outpost::sip::OperationResult::workerIdError:
-		printf("Wrong worker id\r\n");
-		break;
-	case outpost::sip::OperationResult::responseTypeError:
-		printf("Wrong response type id\r\n");
-		break;
-	case outpost::sip::OperationResult::success:
-	default:
-		break;
+		uint32_t fresh = std::min<uint32_t>(window - missing_count, frame_count - next_new);
+		next_new += fresh;
+		expected = missing_count + fresh;
+		resent_count += missing_count;
+		rounds++;
+
+		sendPacket(packetTransportWrapper, bulk_counter, 0x12, missing.empty() ? outpost::Slice<const uint8_t>::empty() : outpost::asSlice(missing));
 	}
-}
\ No newline at end of file
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	/* Closes the transfer on the worker, the data is complete even if this gets lost */
+	sendPacket(packetTransportWrapper, bulk_counter, 0x12, outpost::Slice<const uint8_t>::empty());
+	responseRouter.receiveStream(response, outpost::time::Seconds(1));
+	responseRouter.stopStream();
+
+	printf("Read %u Bytes in %.2f s, %.1f KiB/s, %u frames resent in %u rounds\n",
+		length, elapsed.count(), length / 1024.0 / elapsed.count(), resent_count, rounds);
+
+	return data;
+}
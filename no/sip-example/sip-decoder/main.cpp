@@ -0,0 +1,235 @@
+/*
+ * Decodes experiment results in the record format of code/inc/resultrecord.h,
+ * as they are read with TESTDATA or MEMORY_DUMP, in a single pass over the dump.
+ */
+
+#include <popl.hpp>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstring>
+
+#include <stdio.h>
+
+#include <iostream>
+
+#include "resultrecord.h"
+
+#define MAX_RECORD_SIZE (RECORD_HEADER_SIZE + 0xFFFF + RECORD_CRC_SIZE)
+
+uint16_t crc16(const uint8_t* buffer, size_t size);
+void printRecord(const RecordSchema& schema, uint32_t timestamp, const uint8_t* payload, bool csv);
+uint32_t readValue(const uint8_t* src, uint8_t size);
+
+int main(int argc, char** argv)
+{
+	popl::OptionParser op("Allowed options");
+	auto help_option = op.add<popl::Switch>("h", "help", "produce help message");
+	auto input = op.add<popl::Value<std::string>>("i", "input", "dump of the results, - for stdin", "-");
+	auto csv_option = op.add<popl::Switch>("c", "csv", "print one comma separated line per record");
+	auto schema_option = op.add<popl::Switch>("s", "schema", "print the known record types");
+	try
+	{
+		op.parse(argc, argv);
+
+		if (help_option->count() == 1)
+		{
+			printf("%s", op.help().c_str());
+			return 0;
+		}
+
+		if (schema_option->count() == 1)
+		{
+			for (const RecordSchema& schema : RECORD_SCHEMAS)
+			{
+				printf("%d %s, %u bytes\n", schema.type, schema.name, schema.length);
+				for (uint8_t i = 0; i < schema.field_count; i++)
+				{
+					printf("\t%s[%u], %u bytes\n", schema.fields[i].name, schema.fields[i].count, fieldSize(schema.fields[i]));
+				}
+			}
+			return 0;
+		}
+
+		std::ifstream file;
+		std::istream* in = &std::cin;
+		if (input->value() != "-")
+		{
+			file.open(input->value(), std::ios::binary);
+			if (!file)
+			{
+				std::cerr << "Error opening file: " << input->value() << std::endl;
+				return 1;
+			}
+			in = &file;
+		}
+
+		std::vector<uint8_t> record(MAX_RECORD_SIZE);
+		uint32_t records = 0;
+		uint32_t errors = 0;
+		uint64_t offset = 0;
+		bool resyncing = false;
+
+		/* Only the record in front is kept, bytes are read as the headers ask for them */
+		uint32_t buffered = 0;
+		auto fill = [&](uint32_t len)
+		{
+			if (buffered < len)
+			{
+				in->read(reinterpret_cast<char*>(record.data() + buffered), len - buffered);
+				buffered += in->gcount();
+			}
+			return buffered >= len;
+		};
+		auto drop = [&](uint32_t len)
+		{
+			memmove(record.data(), record.data() + len, buffered - len);
+			buffered -= len;
+			offset += len;
+		};
+
+		while (fill(RECORD_HEADER_SIZE))
+		{
+			uint8_t type = record[0];
+			if (type == RECORD_PAD)
+			{
+				/* Lost data, the record behind the gap may be cut off, so it is resynced without counting an error */
+				uint64_t gap = offset;
+				while (fill(1) && record[0] == RECORD_PAD)
+				{
+					drop(1);
+				}
+				fprintf(stderr, "Skipped %lu padding bytes at %lu\n", offset - gap, gap);
+				resyncing = true;
+				continue;
+			}
+
+			if (!resyncing && (type == 0x00 || type == 0xFF))
+			{
+				/* End of the recorded data */
+				break;
+			}
+
+			const RecordSchema* schema = findSchema(type);
+			uint16_t length = record[2] << 8 | record[3];
+			if (!schema || record[1] != RECORD_SCHEMA_VERSION || length != schema->length)
+			{
+				if (!resyncing)
+				{
+					fprintf(stderr, "Unknown record type %d version %d at %lu, resyncing\n", type, record[1], offset);
+					errors++;
+					resyncing = true;
+				}
+				drop(1);
+				continue;
+			}
+
+			uint32_t size = RECORD_HEADER_SIZE + length + RECORD_CRC_SIZE;
+			if (!fill(size))
+			{
+				fprintf(stderr, "Record %s at %lu is cut off\n", schema->name, offset);
+				errors++;
+				break;
+			}
+
+			uint16_t crc = record[size - 2] << 8 | record[size - 1];
+			if (crc16(record.data(), size - RECORD_CRC_SIZE) != crc)
+			{
+				if (!resyncing)
+				{
+					fprintf(stderr, "CRC error in record %s at %lu, resyncing\n", schema->name, offset);
+					errors++;
+					resyncing = true;
+				}
+				drop(1);
+				continue;
+			}
+
+			resyncing = false;
+
+			uint32_t timestamp = readValue(&record[4], 4);
+			printRecord(*schema, timestamp, &record[RECORD_HEADER_SIZE], csv_option->count() == 1);
+			records++;
+			drop(size);
+		}
+
+		fprintf(stderr, "%u records, %u errors\n", records, errors);
+		return errors ? 1 : 0;
+	}
+	catch (std::exception& e)
+	{
+		printf("Failed: %s\r\n", e.what());
+		return 1;
+	}
+
+	return 0;
+}
+
+uint32_t readValue(const uint8_t* src, uint8_t size)
+{
+	uint32_t value = 0;
+	for (uint8_t i = 0; i < size; i++)
+	{
+		value = value << 8 | src[i];
+	}
+	return value;
+}
+
+void printRecord(const RecordSchema& schema, uint32_t timestamp, const uint8_t* payload, bool csv)
+{
+	/* Timer runs with 8 MHz */
+	if (csv)
+	{
+		printf("%s,%u", schema.name, timestamp);
+	}
+	else
+	{
+		printf("%10.3f s %s", timestamp / 8000000.0, schema.name);
+	}
+
+	for (uint8_t i = 0; i < schema.field_count; i++)
+	{
+		const RecordField& field = schema.fields[i];
+		uint8_t size = field.type & 0x0F;
+
+		if (!csv)
+		{
+			printf(" %s=", field.name);
+		}
+
+		for (uint8_t n = 0; n < field.count; n++)
+		{
+			uint32_t value = readValue(payload, size);
+			payload += size;
+
+			printf(csv ? "," : (n ? " " : ""));
+			if (field.type == FIELD_FLOAT)
+			{
+				float f;
+				memcpy(&f, &value, sizeof(f));
+				printf("%g", f);
+			}
+			else
+			{
+				printf("%u", value);
+			}
+		}
+	}
+
+	printf("\n");
+}
+
+uint16_t crc16(const uint8_t* buffer, size_t size)
+{
+	/* CCITT with init 0xFFFF, same as crc16_ccitt() of the firmware */
+	uint16_t crc = 0xFFFF;
+	while (size-- > 0)
+	{
+		crc ^= *(buffer++) << 8;
+		for (uint8_t bit = 0; bit < 8; bit++)
+		{
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+	}
+	return crc;
+}
@@ -0,0 +1,162 @@
+/*
+ * Drives the SIP command router of the payload (code/inc/sipcommandrouter.h) on the host,
+ * the responses go into a recording sink instead of the UART
+ */
+
+#include <vector>
+#include <string>
+
+#include <stdio.h>
+#include <stdarg.h>
+
+#include "sipcommandrouter.h"
+
+uint8_t log_levels[LOG_MODULE_COUNT] = {LOG_LEVEL, LOG_LEVEL, LOG_LEVEL, LOG_LEVEL, LOG_LEVEL, LOG_LEVEL, LOG_LEVEL, LOG_LEVEL};
+
+/* Warnings of the router are only counted, the tests check that they happen */
+static uint32_t logged_warnings = 0;
+
+void log(const char* prefix, const char* file, const char* function, uint32_t line, const char* format, ...)
+{
+	(void)prefix;
+	(void)file;
+	(void)function;
+	(void)line;
+	(void)format;
+	logged_warnings++;
+}
+
+/*
+ * Keeps every ACK/NACK, streamed responses are only counted
+ */
+struct RecordingSink : public SipResponseSink
+{
+	struct AckNack
+	{
+		uint8_t sequence;
+		uint8_t ack;
+	};
+
+	std::vector<AckNack> answers;
+	uint32_t responses = 0;
+
+	void beginResponse(uint8_t sequence, uint8_t power_state, uint8_t response_type, uint16_t data_len) override
+	{
+		(void)sequence;
+		(void)power_state;
+		(void)response_type;
+		(void)data_len;
+		responses++;
+	}
+
+	void writeResponseData(const uint8_t* data, uint32_t len) override
+	{
+		(void)data;
+		(void)len;
+	}
+
+	void endResponse() override
+	{
+	}
+
+	void sendAck(uint8_t sequence) override
+	{
+		answers.push_back({sequence, ACK});
+	}
+
+	void sendNack(uint8_t sequence) override
+	{
+		answers.push_back({sequence, NACK});
+	}
+
+	void sendAckNack(uint8_t sequence, uint8_t ack, const uint8_t* data, uint16_t len) override
+	{
+		(void)data;
+		(void)len;
+		answers.push_back({sequence, ack});
+	}
+};
+
+/*
+ * ACKs every command and remembers the function codes it got
+ */
+struct AckingHandler : public SipCommandHandler
+{
+	AckingHandler(SipResponseSink& sip) : sip(sip) {}
+
+	void handle(SIPCommand& command) override
+	{
+		codes.push_back(command.getFunctionCode());
+		sip.sendAck(command.getSequenceNum());
+	}
+
+	SipResponseSink& sip;
+	std::vector<uint8_t> codes;
+};
+
+static uint32_t failures = 0;
+
+static void check(bool condition, const std::string& name)
+{
+	printf("%s: %s\n", condition ? "OK    " : "FAILED", name.c_str());
+	if (!condition)
+	{
+		failures++;
+	}
+}
+
+static SIPCommand& makeCommand(SIPCommand& command, uint8_t sequence, uint8_t function_code)
+{
+	command.sip_data.sequence = sequence;
+	command.sip_data.code_or_type = function_code;
+	command.sip_data.length = LENGTH_WITHOUT_DATA;
+	command.sip_data.data_length = 0;
+	return command;
+}
+
+int main()
+{
+	RecordingSink sink;
+	SipCommandRouter router(sink);
+	AckingHandler first(sink);
+	AckingHandler second(sink);
+	/* Too big for the stack with its buffer */
+	static SIPCommand command;
+
+	check(router.add(Command::RISA_INIT_COMMAND_ID, &first), "register a free code");
+	check(router.add(Command::TEST_START_COMMAND_ID, &second), "register a second handler");
+	check(router.add(Command::TEST_STATUS_COMMAND_ID, &second), "register one handler for two codes");
+
+	logged_warnings = 0;
+	check(!router.add(Command::RISA_INIT_COMMAND_ID, &second), "reject a code that is already taken");
+	check(!router.add(SIP_ROUTER_TABLE_SIZE, &second), "reject a code behind the table");
+	check(logged_warnings == 2, "warn about rejected codes");
+
+	router.dispatch(makeCommand(command, 1, Command::RISA_INIT_COMMAND_ID));
+	check(first.codes.size() == 1 && second.codes.empty(), "dispatch to the registered handler");
+	check(sink.answers.size() == 1 && sink.answers[0].sequence == 1 && sink.answers[0].ack == ACK, "handler answers through the sink");
+
+	router.dispatch(makeCommand(command, 2, Command::TEST_START_COMMAND_ID));
+	router.dispatch(makeCommand(command, 3, Command::TEST_STATUS_COMMAND_ID));
+	check(second.codes.size() == 2 && second.codes[0] == Command::TEST_START_COMMAND_ID && second.codes[1] == Command::TEST_STATUS_COMMAND_ID,
+		"dispatch both codes to the shared handler");
+
+	sink.answers.clear();
+	router.dispatch(makeCommand(command, 4, Command::MEMORY_DUMP_COMMAND_ID));
+	check(sink.answers.size() == 1 && sink.answers[0].sequence == 4 && sink.answers[0].ack == NACK, "NACK a code without handler");
+
+	sink.answers.clear();
+	router.dispatch(makeCommand(command, 5, 0xFF));
+	check(sink.answers.size() == 1 && sink.answers[0].sequence == 5 && sink.answers[0].ack == NACK, "NACK a code behind the table");
+
+	check(first.codes.size() == 1 && second.codes.size() == 2 && sink.responses == 0, "unknown codes reach no handler");
+
+	if (failures)
+	{
+		printf("%u checks failed\n", failures);
+		return 1;
+	}
+
+	printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,234 @@
+/*
+ * Runs the flash scan of the payload (code/inc/flashscanengine.h) against a file backed flash model
+ * and compares its throughput with a plain byte by byte compare against a stored copy of the pattern.
+ */
+
+#include <popl.hpp>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <random>
+#include <chrono>
+
+#include <stdio.h>
+
+#include <iostream>
+
+#include "flashscanengine.h"
+
+/*
+ * Stands in for the MX25R6435F, every byte handed out by readNext() counts as one SPI transfer.
+ * Addresses wrap around like on the real flash, programming can only clear bits
+ */
+struct FileFlash
+{
+	std::vector<uint8_t> image;
+	uint32_t cursor = 0;
+	uint64_t transfers = 0;
+
+	void beginRead(uint32_t address)
+	{
+		cursor = address;
+	}
+
+	uint8_t readNext(bool more)
+	{
+		(void)more;
+		transfers++;
+		return image[cursor++ % image.size()];
+	}
+
+	void endRead()
+	{
+	}
+
+	void write(uint32_t address, const uint8_t* data, uint32_t len)
+	{
+		for (uint32_t i = 0; i < len; i++)
+		{
+			image[(address + i) % image.size()] &= data[i];
+		}
+	}
+};
+
+struct CountingSink : public ScanMismatchSink
+{
+	uint64_t bytes = 0;
+	uint64_t bits = 0;
+
+	void onMismatch(const ScanMismatch& mismatch) override
+	{
+		bytes++;
+		bits += __builtin_popcount(mismatch.flipped);
+	}
+};
+
+uint32_t injectFlips(FileFlash &flash, uint32_t length, uint32_t flips, uint32_t random_seed);
+uint64_t scanEngine(FileFlash &flash, uint32_t length, uint32_t seed, uint32_t passes, double &seconds);
+uint64_t scanStored(FileFlash &flash, uint32_t length, uint32_t seed, uint32_t passes, double &seconds);
+
+int main(int argc, char** argv)
+{
+	popl::OptionParser op("Allowed options");
+	auto help_option = op.add<popl::Switch>("h", "help", "produce help message");
+	auto input = op.add<popl::Value<std::string>>("i", "input", "flash image to scan, generated if not given");
+	auto output = op.add<popl::Value<std::string>>("o", "output", "store the generated image");
+	auto size_option = op.add<popl::Value<uint32_t>>("s", "size", "scanned bytes", 0x800000 - 4096);
+	auto seed_option = op.add<popl::Value<uint32_t>>("", "seed", "seed of the reference pattern", 0x2545F491);
+	auto flips_option = op.add<popl::Value<uint32_t>>("f", "flips", "bit flips injected into a generated image", 100);
+	auto passes_option = op.add<popl::Value<uint32_t>>("p", "passes", "scan passes that are timed", 5);
+	try
+	{
+		op.parse(argc, argv);
+
+		if (help_option->count() == 1)
+		{
+			printf("%s", op.help().c_str());
+			return 0;
+		}
+
+		FileFlash flash;
+		uint32_t length = size_option->value() & ~0x03;
+		uint32_t seed = seed_option->value();
+		uint32_t passes = std::max<uint32_t>(passes_option->value(), 1);
+
+		if (input->is_set())
+		{
+			std::ifstream fin(input->value(), std::ios::binary);
+			if (!fin)
+			{
+				std::cerr << "Error opening file: " << input->value() << std::endl;
+				return 1;
+			}
+			flash.image.assign((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+			fin.close();
+
+			if (flash.image.size() < length)
+			{
+				std::cerr << "Image is smaller than the scanned size" << std::endl;
+				return 1;
+			}
+		}
+		else
+		{
+			/* Erased flash, programmed the same way the experiment does it */
+			flash.image.assign(length, 0xFF);
+			FlashScanEngine<FileFlash> programmer(flash);
+			programmer.programPattern(0, length, seed);
+
+			uint32_t flipped = injectFlips(flash, length, flips_option->value(), seed);
+			printf("Generated %u bytes, %u bits flipped\n", length, flipped);
+
+			if (output->is_set())
+			{
+				std::ofstream fout(output->value(), std::ios::binary);
+				fout.write(reinterpret_cast<const char*>(flash.image.data()), flash.image.size());
+				fout.close();
+			}
+		}
+
+		double engine_seconds;
+		double stored_seconds;
+		uint64_t engine_mismatches = scanEngine(flash, length, seed, passes, engine_seconds);
+		uint64_t stored_mismatches = scanStored(flash, length, seed, passes, stored_seconds);
+
+		double megabytes = (double)length * passes / (1024 * 1024);
+		printf("FlashScanEngine: %8.1f MB/s, %llu mismatching bytes per pass\n", megabytes / engine_seconds, (unsigned long long)engine_mismatches);
+		printf("Stored pattern:  %8.1f MB/s, %llu mismatching bytes per pass\n", megabytes / stored_seconds, (unsigned long long)stored_mismatches);
+
+		if (engine_mismatches != stored_mismatches)
+		{
+			printf("FAILED: the scan engine and the stored pattern disagree\n");
+			return 1;
+		}
+	}
+	catch (std::exception& e)
+	{
+		printf("Failed: %s\r\n", e.what());
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Flips random bits in both directions, like radiation would
+ */
+uint32_t injectFlips(FileFlash &flash, uint32_t length, uint32_t flips, uint32_t random_seed)
+{
+	std::mt19937 rng(random_seed);
+	std::uniform_int_distribution<uint32_t> address(0, length - 1);
+	std::uniform_int_distribution<uint32_t> bit(0, 7);
+
+	for (uint32_t i = 0; i < flips; i++)
+	{
+		flash.image[address(rng)] ^= 1 << bit(rng);
+	}
+
+	return flips;
+}
+
+uint64_t scanEngine(FileFlash &flash, uint32_t length, uint32_t seed, uint32_t passes, double &seconds)
+{
+	CountingSink sink;
+	FlashScanEngine<FileFlash> engine(flash, &sink);
+	uint64_t mismatches = 0;
+
+	flash.transfers = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t pass = 0; pass < passes; pass++)
+	{
+		engine.begin(0, length, seed);
+		mismatches = engine.scan();
+	}
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (flash.transfers != (uint64_t)length * passes)
+	{
+		printf("Scan engine read %llu bytes instead of %llu\n", (unsigned long long)flash.transfers, (unsigned long long)length * passes);
+	}
+
+	return mismatches;
+}
+
+/*
+ * What the scan looked like before the engine, the chunk is read into a buffer
+ * and compared byte by byte against a copy of the whole pattern
+ */
+uint64_t scanStored(FileFlash &flash, uint32_t length, uint32_t seed, uint32_t passes, double &seconds)
+{
+	std::vector<uint32_t> words(length / sizeof(uint32_t));
+	ScanPattern::fill(words.data(), 0, words.size(), seed);
+	const uint8_t* pattern = reinterpret_cast<const uint8_t*>(words.data());
+
+	uint8_t chunk[FlashScanEngine<FileFlash>::CHUNK_SIZE];
+	uint64_t mismatches = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t pass = 0; pass < passes; pass++)
+	{
+		mismatches = 0;
+		for (uint32_t offset = 0; offset < length; offset += sizeof(chunk))
+		{
+			uint32_t chunk_len = std::min<uint32_t>(sizeof(chunk), length - offset);
+
+			flash.beginRead(offset);
+			for (uint32_t i = 0; i < chunk_len; i++)
+			{
+				chunk[i] = flash.readNext(i + 1 < chunk_len);
+			}
+			flash.endRead();
+
+			for (uint32_t i = 0; i < chunk_len; i++)
+			{
+				if (chunk[i] != pattern[offset + i])
+				{
+					mismatches++;
+				}
+			}
+		}
+	}
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	return mismatches;
+}
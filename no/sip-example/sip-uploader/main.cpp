@@ -27,11 +27,16 @@
 #include <outpost/sip/packet/packet_writer.h>
 #include <outpost/sip/packet_transport/packet_transport_wrapper.h>
 #include <outpost/rtos/clock.h>
+#include <outpost/coding/crc16.h>
+#include <outpost/coding/crc32.h>
 
 #include <stdio.h>
 
 #include <iostream>
 
+#include "response_router.h"
+#include "sip_transfer.h"
+
 outpost::rtos::SystemClock systemClock;
 
 std::array<uint8_t, 5000> transmitBuffer;
@@ -44,15 +49,19 @@ outpost::transport::BufferedFrameDecoderHdlc frameDecoderHdlc(outpost::asSlice(r
 outpost::transport::FrameTransportSerial frameTransportSerial(systemClock, sipPort, frameEncoderHdlc, outpost::asSlice(transmitBuffer), frameDecoderHdlc);
 outpost::sip::PacketTransportWrapper packetTransportWrapper(frameTransportSerial);
 
-outpost::sip::Coordinator sipCoordinator(packetTransportWrapper);
-outpost::sip::CoordinatorPacketReceiver sipReceiver(packetTransportWrapper, sipCoordinator, outpost::support::parameter::HeartbeatSource::default0, 1U);
+/* Requests of the Coordinator go through the tracker, so only responses to the last one reach it */
+RequestTracker requestTracker(packetTransportWrapper);
+outpost::sip::Coordinator sipCoordinator(requestTracker);
+ResponseRouter responseRouter(packetTransportWrapper, sipCoordinator, requestTracker);
 
 uint8_t responseData[4096];
 outpost::Slice<uint8_t> responseSlice(responseData);
 
-void startDataWrite(std::vector<uint8_t> &data, uint32_t address, bool write_flash);
-void sendAllData(std::vector<uint8_t> &data);
+void startDataWrite(std::vector<uint8_t> &data, uint32_t address, bool write_flash, bool verify, bool pipelined);
+void sendAllData(std::vector<uint8_t> &data, bool verify, uint8_t window);
+void printAck(const std::vector<uint8_t> &chunk, bool verify);
 std::vector<uint8_t> dumpData(uint32_t address, bool write_flash, uint32_t len);
+void registerSlot(const std::vector<uint8_t> &data, uint8_t slot, uint32_t address, uint16_t version);
 uint8_t counter = 0;
 
 int main(int argc, char** argv)
@@ -67,6 +76,13 @@ int main(int argc, char** argv)
 			op.add<popl::Value<uint32_t>>("b", "baud", "Baudrate for serial port", 115200);
 	auto parity =
 			op.add<popl::Value<char>>("r", "parity", "Parity for serial port", 'n');
+	auto verify_option = op.add<popl::Switch>("v", "verify", "let the payload read back every chunk and check its CRC16");
+	auto window_option =
+			op.add<popl::Value<uint32_t>>("w", "window", "chunks in flight without an ACK, 0 waits for every ACK (always with verify)", 4);
+	auto slot_option =
+			op.add<popl::Value<uint32_t>>("s", "slot", "enter the uploaded bitstream into this slot of the payload's slot table");
+	auto slot_version_option =
+			op.add<popl::Value<uint32_t>>("", "slot-version", "version stored with the slot", 0);
 	try
 	{
 		op.parse(argc, argv);
@@ -94,7 +110,7 @@ int main(int argc, char** argv)
 
 		sipPort.open(port->value(), baud->value(), p);
 
-		sipReceiver.start();
+		responseRouter.start();
 
 		outpost::sip::OperationResult res;
 		// wait for command line input:
@@ -122,8 +138,15 @@ int main(int argc, char** argv)
 		}
 		fin.close();
 
-		startDataWrite(filebytes, memory_address, true);
-		sendAllData(filebytes);
+		bool verify = verify_option->count() == 1;
+		uint8_t window = verify ? 0 : std::min<uint32_t>(window_option->value(), 255);
+		startDataWrite(filebytes, memory_address, true, verify, window > 0);
+		sendAllData(filebytes, verify, window);
+
+		if(slot_option->is_set())
+		{
+			registerSlot(filebytes, slot_option->value(), memory_address, slot_version_option->value());
+		}
 
 		#if 0
 		const size_t chunkSize = 10000;
@@ -196,12 +219,55 @@ std::vector<uint8_t> dumpData(uint32_t address, bool write_flash, uint32_t len)
 	}
 }
 
-void startDataWrite(std::vector<uint8_t> &data, uint32_t address, bool write_flash)
+void registerSlot(const std::vector<uint8_t> &data, uint8_t slot, uint32_t address, uint16_t version)
+{
+	outpost::sip::OperationResult res;
+	uint32_t len = data.size();
+
+	uint8_t payload[] = {slot, static_cast<uint8_t>((address & 0xFF)), static_cast<uint8_t>((address >> 8)), static_cast<uint8_t>((address >> 16)),
+	static_cast<uint8_t>(len), static_cast<uint8_t>((len >> 8)), static_cast<uint8_t>((len >> 16)),
+	static_cast<uint8_t>(version), static_cast<uint8_t>((version >> 8))};
+	printf("Registering slot %d: address %u, len %u, version %d\n", slot, address, len, version);
+	res = sipCoordinator.sendRequestGetResponseData(
+		0x01, // target worker id
+		counter++, // message counter
+		0x13, // type
+		0x08, // expected response type
+		outpost::asSlice(payload),
+		responseSlice
+		);
+
+	if(outpost::sip::OperationResult::success != res)
+	{
+		printf("Slot not registered, no response\n");
+		return;
+	}
+
+	if(responseData[0] != 1)
+	{
+		printf("Slot not registered, got NACK\n");
+		return;
+	}
+
+	/* The payload calculated the CRC over what is actually in its flash */
+	uint32_t flash_crc = readLe(&responseData[1], 4);
+	uint32_t file_crc = outpost::Crc32Reversed::calculate(outpost::asSlice(data));
+	if(flash_crc != file_crc)
+	{
+		printf("Slot %d registered, but its CRC32 0x%08X doesnt match the file (0x%08X)\n", slot, flash_crc, file_crc);
+		return;
+	}
+
+	printf("Slot %d registered, CRC32 0x%08X\n", slot, flash_crc);
+}
+
+void startDataWrite(std::vector<uint8_t> &data, uint32_t address, bool write_flash, bool verify, bool pipelined)
 {
 	outpost::sip::OperationResult res;
 
 	uint8_t payload[] = {write_flash, static_cast<uint8_t>((address & 0xFF)), static_cast<uint8_t>((address >> 8)), 
-	static_cast<uint8_t>((address >> 16)), static_cast<uint8_t>(data.size()), static_cast<uint8_t>((data.size() >> 8)), static_cast<uint8_t>((data.size() >> 16))};
+	static_cast<uint8_t>((address >> 16)), static_cast<uint8_t>(data.size()), static_cast<uint8_t>((data.size() >> 8)), static_cast<uint8_t>((data.size() >> 16)),
+	verify, pipelined};
 	printf("INIT with len %d\n", data.size());
 	//send your request here
 	res = sipCoordinator.sendRequestGetResponseData(
@@ -231,8 +297,14 @@ void startDataWrite(std::vector<uint8_t> &data, uint32_t address, bool write_fla
 	}
 }
 
-void sendAllData(std::vector<uint8_t> &data)
+void sendAllData(std::vector<uint8_t> &data, bool verify, uint8_t window)
 {
+	if(window > 0)
+	{
+		sendAllDataPipelined(responseRouter, packetTransportWrapper, counter, data, window);
+		return;
+	}
+
 	outpost::sip::OperationResult res;
 	const uint16_t max_per_package = 250;
 	uint32_t num_packages = data.size() / max_per_package;
@@ -265,14 +337,7 @@ void sendAllData(std::vector<uint8_t> &data)
 
 		if(outpost::sip::OperationResult::success == res)
 		{
-			if(responseData[0] == 1)
-			{
-				printf("Got ACK\n");
-			}
-			else
-			{
-				printf("Got NACK\n");
-			}
+			printAck(cur_vector, verify);
 		}
 
 		switch(res)
@@ -321,14 +386,7 @@ void sendAllData(std::vector<uint8_t> &data)
 
 	if(outpost::sip::OperationResult::success == res)
 	{
-		if(responseData[0] == 1)
-		{
-			printf("Got ACK\n");
-		}
-		else
-		{
-			printf("Got NACK\n");
-		}
+		printAck(cur_vector, verify);
 	}
 
 	switch(res)
@@ -349,4 +407,34 @@ void sendAllData(std::vector<uint8_t> &data)
 	default:
 		break;
 	}
-}
\ No newline at end of file
+}
+
+void printAck(const std::vector<uint8_t> &chunk, bool verify)
+{
+	if(responseData[0] == 1)
+	{
+		printf("Got ACK\n");
+	}
+	else
+	{
+		printf("Got NACK\n");
+	}
+
+	if(!verify)
+	{
+		return;
+	}
+
+	/* The payload sends the CRC16 of the read back chunk behind the ACK byte, the first 2 bytes of the chunk are its length */
+	uint16_t read_crc = responseData[1] | responseData[2] << 8;
+	uint16_t sent_crc = outpost::Crc16Ccitt::calculate(outpost::asSlice(chunk).skipFirst(2));
+
+	if(read_crc == sent_crc)
+	{
+		printf("Verified, CRC 0x%04X\n", read_crc);
+	}
+	else
+	{
+		printf("Verify failed, read back CRC 0x%04X, sent CRC 0x%04X\n", read_crc, sent_crc);
+	}
+}